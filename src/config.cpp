@@ -10,6 +10,8 @@
 #include <string>
 #include <vector>
 
+#include <caeventmask.h>
+#include <epicsString.h>
 #include <yajl_parse.h>
 
 #include <epics-diode/config.h>
@@ -24,12 +26,15 @@ Logger config_logger("config");
 struct ParserContext {
     uint32_t level = 0;
     std::string current_key;
+    std::string current_section;    // top-level key
     Config &config;
     ConfigChannel* current_channel;
+    ConfigDestination* current_destination;
 
     explicit ParserContext(Config &config) :
         config(config),
-        current_channel(nullptr)
+        current_channel(nullptr),
+        current_destination(nullptr)
     {
     }
 };
@@ -45,6 +50,26 @@ static int parser_yajl_null(void *ctx)
 
 static int parser_yajl_boolean(void *ctx, int bval)
 {
+    auto* context = static_cast<ParserContext*>(ctx);
+    if (context->level == 1) {
+        if (context->current_key == "latency_telemetry") {
+            context->config.latency_telemetry = (bval != 0);
+        } else if (context->current_key == "variable_length_arrays") {
+            context->config.variable_length_arrays = (bval != 0);
+        } else if (context->current_key == "immediate_flush") {
+            context->config.immediate_flush = (bval != 0);
+        } else if (context->current_key == "preemptive_callbacks") {
+            context->config.preemptive_callbacks = (bval != 0);
+        }
+    } else if (context->level == 3 && context->current_channel) {
+        if (context->current_key == "deadband_per_element") {
+            context->current_channel->deadband_per_element = (bval != 0);
+        } else if (context->current_key == "delta_encoding") {
+            context->current_channel->delta_encoding = (bval != 0);
+        } else if (context->current_key == "array_delta") {
+            context->current_channel->array_delta = (bval != 0);
+        }
+    }
     return 1;
 }
 
@@ -58,8 +83,50 @@ static int parser_yajl_double(void *ctx, double dval)
             context->config.polled_fields_update_period = dval;
         } else if (context->current_key == "heartbeat_period") {
             context->config.heartbeat_period = dval;
+        } else if (context->current_key == "beacon_period") {
+            context->config.beacon_period = dval;
         } else if (context->current_key == "rate_limit_mbs") {
             context->config.rate_limit_mbs = dval;
+        } else if (context->current_key == "heartbeat_bandwidth_share") {
+            context->config.heartbeat_bandwidth_share = dval;
+        } else if (context->current_key == "fragment_bandwidth_share") {
+            context->config.fragment_bandwidth_share = dval;
+        } else if (context->current_key == "full_refresh_period") {
+            context->config.full_refresh_period = dval;
+        } else if (context->current_key == "latency_budget") {
+            context->config.latency_budget = dval;
+        } else if (context->current_key == "transmit_buffers") {
+            context->config.transmit_buffers = dval;
+        } else if (context->current_key == "sender_shards") {
+            context->config.sender_shards = dval;
+        } else if (context->current_key == "connect_batch_size") {
+            context->config.connect_batch_size = dval;
+        } else if (context->current_key == "reorder_window") {
+            context->config.reorder_window = dval;
+        }
+    } else if (context->level == 3 && context->current_channel) {
+        if (context->current_key == "deadband_abs") {
+            context->current_channel->deadband_abs = dval;
+        } else if (context->current_key == "deadband_rel") {
+            context->current_channel->deadband_rel = dval;
+        } else if (context->current_key == "ca_dbnd") {
+            context->current_channel->ca_dbnd = dval;
+        } else if (context->current_key == "ca_dec") {
+            context->current_channel->ca_dec = dval;
+        } else if (context->current_key == "min_update_period") {
+            context->current_channel->min_update_period = dval;
+        } else if (context->current_key == "array_offset") {
+            context->current_channel->array_offset = dval;
+        } else if (context->current_key == "array_count") {
+            context->current_channel->array_count = dval;
+        } else if (context->current_key == "array_stride") {
+            context->current_channel->array_stride = dval;
+        } else if (context->current_key == "encoding_scale") {
+            context->current_channel->encoding_scale = dval;
+        } else if (context->current_key == "encoding_offset") {
+            context->current_channel->encoding_offset = dval;
+        } else if (context->current_key == "keyframe_interval") {
+            context->current_channel->keyframe_interval = dval;
         }
     }
     return 1;
@@ -73,7 +140,29 @@ static int parser_yajl_integer(void *ctx, long long ival)
 static int parser_yajl_string(void *ctx, const unsigned char * sval, size_t len)
 {
     auto* context = static_cast<ParserContext*>(ctx);
-    if (context->level == 3) {
+    if (context->level == 1) {
+        std::string value = std::string(reinterpret_cast<const char*>(sval), len);
+        if (context->current_key == "priority_scheduling") {
+            if (value == "strict") {
+                context->config.priority_scheduling = PriorityScheduling::strict;
+            } else if (value == "weighted") {
+                context->config.priority_scheduling = PriorityScheduling::weighted;
+            } else {
+                config_logger.log(LogLevel::Config, "Unknown priority scheduling '%s'.", value.c_str());
+            }
+        } else if (context->current_key == "channel_cache") {
+            context->config.channel_cache = value;
+        }
+    } else if (context->level == 3 && context->current_destination) {
+        std::string value = std::string(reinterpret_cast<const char*>(sval), len);
+        if (context->current_key == "address") {
+            context->current_destination->address = value;
+        } else if (context->current_key == "channels") {
+            context->current_destination->channels.push_back(value);
+        } else if (context->current_key == "groups") {
+            context->current_destination->groups.push_back(value);
+        }
+    } else if (context->level == 3) {
         std::string value = std::string(reinterpret_cast<const char*>(sval), len);
         if (context->current_key == "extra_fields") {
             if (context->current_channel) {
@@ -83,6 +172,83 @@ static int parser_yajl_string(void *ctx, const unsigned char * sval, size_t len)
             if (context->current_channel) {
                 context->current_channel->polled_fields.push_back(value);
             }
+        } else if (context->current_key == "priority") {
+            if (context->current_channel) {
+                if (value == "high") {
+                    context->current_channel->priority = Priority::high;
+                } else if (value == "normal") {
+                    context->current_channel->priority = Priority::normal;
+                } else if (value == "low") {
+                    context->current_channel->priority = Priority::low;
+                } else {
+                    config_logger.log(LogLevel::Config, "Unknown priority '%s' of channel '%s'.",
+                                      value.c_str(), context->current_channel->channel_name.c_str());
+                }
+            }
+        } else if (context->current_key == "dedup") {
+            if (context->current_channel) {
+                if (value == "none") {
+                    context->current_channel->dedup = DedupMode::none;
+                } else if (value == "dbr") {
+                    context->current_channel->dedup = DedupMode::dbr;
+                } else if (value == "value") {
+                    context->current_channel->dedup = DedupMode::value;
+                } else {
+                    config_logger.log(LogLevel::Config, "Unknown dedup mode '%s' of channel '%s'.",
+                                      value.c_str(), context->current_channel->channel_name.c_str());
+                }
+            }
+        } else if (context->current_key == "array_binning") {
+            if (context->current_channel) {
+                if (value == "none") {
+                    context->current_channel->array_binning = ArrayBinning::none;
+                } else if (value == "min") {
+                    context->current_channel->array_binning = ArrayBinning::min;
+                } else if (value == "max") {
+                    context->current_channel->array_binning = ArrayBinning::max;
+                } else if (value == "mean") {
+                    context->current_channel->array_binning = ArrayBinning::mean;
+                } else {
+                    config_logger.log(LogLevel::Config, "Unknown array binning '%s' of channel '%s'.",
+                                      value.c_str(), context->current_channel->channel_name.c_str());
+                }
+            }
+        } else if (context->current_key == "encoding") {
+            if (context->current_channel) {
+                if (value == "none") {
+                    context->current_channel->encoding = Encoding::none;
+                } else if (value == "float32") {
+                    context->current_channel->encoding = Encoding::float32;
+                } else if (value == "int16") {
+                    context->current_channel->encoding = Encoding::int16;
+                } else {
+                    config_logger.log(LogLevel::Config, "Unknown encoding '%s' of channel '%s'.",
+                                      value.c_str(), context->current_channel->channel_name.c_str());
+                }
+            }
+        } else if (context->current_key == "ca_filter") {
+            if (context->current_channel) {
+                context->current_channel->ca_filter = value;
+            }
+        } else if (context->current_key == "group") {
+            if (context->current_channel) {
+                context->current_channel->group = value;
+            }
+        } else if (context->current_key == "event_mask") {
+            if (context->current_channel) {
+                if (value == "value") {
+                    context->current_channel->event_mask |= DBE_VALUE;
+                } else if (value == "alarm") {
+                    context->current_channel->event_mask |= DBE_ALARM;
+                } else if (value == "log" || value == "archive") {
+                    context->current_channel->event_mask |= DBE_LOG;
+                } else if (value == "property") {
+                    context->current_channel->event_mask |= DBE_PROPERTY;
+                } else {
+                    config_logger.log(LogLevel::Config, "Unknown event mask '%s' of channel '%s'.",
+                                      value.c_str(), context->current_channel->channel_name.c_str());
+                }
+            }
         }
     }
     return 1;
@@ -93,16 +259,39 @@ static int parser_yajl_map_key(void *ctx, const unsigned char * sval, size_t len
     auto* context = static_cast<ParserContext*>(ctx);
     context->current_key = std::string(reinterpret_cast<const char*>(sval), len);
     if (context->level == 1) {
+        context->current_section = context->current_key;
         if (!(context->current_key == "min_update_period" ||
               context->current_key == "polled_fields_update_period" ||
               context->current_key == "heartbeat_period" ||
+              context->current_key == "beacon_period" ||
               context->current_key == "rate_limit_mbs" ||
-              context->current_key == "channel_names")) {
+              context->current_key == "heartbeat_bandwidth_share" ||
+              context->current_key == "fragment_bandwidth_share" ||
+              context->current_key == "full_refresh_period" ||
+              context->current_key == "latency_telemetry" ||
+              context->current_key == "variable_length_arrays" ||
+              context->current_key == "priority_scheduling" ||
+              context->current_key == "immediate_flush" ||
+              context->current_key == "latency_budget" ||
+              context->current_key == "transmit_buffers" ||
+              context->current_key == "preemptive_callbacks" ||
+              context->current_key == "sender_shards" ||
+              context->current_key == "connect_batch_size" ||
+              context->current_key == "channel_cache" ||
+              context->current_key == "reorder_window" ||
+              context->current_key == "channel_names" ||
+              context->current_key == "destinations")) {
             parser_log_unknown_node(context);
         }
+    } else if (context->level == 2 && context->current_section == "destinations") {
+        context->config.destinations.emplace_back();
+        context->current_destination = &(context->config.destinations.back());
+        context->current_destination->name = context->current_key;
+        context->current_channel = nullptr;
     } else if (context->level == 2) {
         context->config.channels.emplace_back(context->current_key);
         context->current_channel = &(context->config.channels.back());
+        context->current_destination = nullptr;
     }
     // we do not want to do warning logs on nodes on deeper levels,
     // since we have already logs parent node
@@ -212,6 +401,48 @@ Config get_configuration(const std::string& filename) {
     return config;
 }
 
+bool ConfigDestination::includes(const ConfigChannel& channel) const
+{
+    for (auto& pattern : channels) {
+        if (epicsStrGlobMatch(channel.channel_name.c_str(), pattern.c_str())) {
+            return true;
+        }
+    }
+    if (!channel.group.empty()) {
+        for (auto& group : groups) {
+            if (group == channel.group) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+Config get_destination_configuration(const Config& config, const std::string& destination)
+{
+    for (auto& config_destination : config.destinations) {
+        if (config_destination.name != destination) {
+            continue;
+        }
+
+        Config result = config;
+        result.destinations.clear();
+        result.channels.clear();
+        for (auto& channel : config.channels) {
+            if (config_destination.includes(channel)) {
+                result.channels.push_back(channel);
+            }
+        }
+        result.update_hash();
+
+        config_logger.log(LogLevel::Info, "Destination '%s': %zu of %zu channel(s).",
+                          destination.c_str(), result.channels.size(), config.channels.size());
+        return result;
+    }
+
+    throw std::runtime_error("unknown destination: " + destination);
+}
+
 std::ostream& operator<<(std::ostream& os, const Config& c)
 {
     for (auto &channel : c.channels) {
@@ -0,0 +1,299 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <cadef.h>
+
+#include <epics-diode/config.h>
+#include <epics-diode/destination.h>
+#include <epics-diode/encoding.h>
+#include <epics-diode/logger.h>
+#include <epics-diode/protocol.h>
+#include <epics-diode/transport.h>
+
+namespace epics_diode {
+
+Destination::Destination(const Config& config, const ConfigDestination& config_destination) :
+    name(config_destination.name),
+    hash(get_destination_configuration(config, config_destination.name).hash),
+    addresses(parse_socket_address_list(config_destination.address, EPICS_DIODE_DEFAULT_PORT))
+{
+    for (auto& channel : config.channels) {
+        bool included = config_destination.includes(channel);
+        std::size_t n = channel.extra_fields.size() + channel.polled_fields.size() + 1;
+        for (std::size_t i = 0; i < n; i++) {
+            ids.push_back(included ? channel_count++ : NO_ID);
+        }
+    }
+}
+
+std::size_t DestinationStream::rewrite(uint8_t* in, std::size_t length, uint8_t* out, std::size_t& prepare_offset)
+{
+    constexpr std::size_t alignment = SubmessageHeader::alignment;
+
+    Serializer is(in, length);
+    Serializer os(out, MAX_MESSAGE_SIZE);
+    is += Header::size;
+    os += Header::size; // skip preset header
+
+    std::size_t out_prepare_offset = 0;
+
+    // submessages are written with explicit sizes, the last one is reset to 0 at the end
+    Serializer::value_type* last_subheader_pos = nullptr;
+    uint8_t last_id = 0;
+    auto begin_submessage = [&](uint8_t id) {
+        if (last_subheader_pos) {
+            auto pos = os.position();
+            os.position(last_subheader_pos);
+            os << SubmessageHeader(
+                    last_id,
+                    SubmessageFlag::LittleEndian,
+                    uint16_t(pos - last_subheader_pos - SubmessageHeader::size));
+            os.position(pos);
+        }
+        last_subheader_pos = os.position();
+        last_id = id;
+        os << SubmessageHeader(id, SubmessageFlag::LittleEndian, 0);
+    };
+
+    // data submessage (with its refreshes) is dropped if it carries no channel of the destination
+    Serializer::value_type* data_pos = nullptr;
+    Serializer::value_type* data_prev_subheader_pos = nullptr;
+    uint8_t data_prev_id = 0;
+    std::size_t data_entries = 0;
+    bool data_sent = false;
+    auto close_data = [&]() {
+        if (!data_pos) {
+            return;
+        }
+        if (data_entries) {
+            seq_no++;
+            data_sent = true;
+        } else {
+            os.position(data_pos);
+            last_subheader_pos = data_prev_subheader_pos;
+            last_id = data_prev_id;
+        }
+        data_pos = nullptr;
+    };
+
+    while (is.ensure(SubmessageHeader::size)) {
+        SubmessageHeader subheader;
+        is >> subheader;
+        auto payload_pos = is.position();
+        Serializer::value_type* payload_end = in + length;
+        if (subheader.bytes_to_next_header) {
+            payload_end = payload_pos + subheader.bytes_to_next_header;
+        }
+
+        if (subheader.id == SubmessageType::CA_DATA_MESSAGE && is.ensure(CADataMessage::size)) {
+            CADataMessage data_msg;
+            is >> data_msg;
+
+            close_data();
+            data_pos = os.position();
+            data_prev_subheader_pos = last_subheader_pos;
+            data_prev_id = last_id;
+            data_entries = 0;
+
+            begin_submessage(SubmessageType::CA_DATA_MESSAGE);
+            uint16_t count = 0;
+            os << CADataMessage(seq_no, count);
+            auto count_pos = os.position() - sizeof(count);
+
+            for (uint16_t i = 0; i < data_msg.channel_count && is.ensure(CAChannelData::size); i++) {
+                CAChannelData channel_data;
+                is >> channel_data;
+
+                std::size_t value_size = 0;
+                if (channel_data.count != (uint16_t)-1) {
+                    value_size = (std::size_t)dbr_size_n(channel_data.type & ~ENCODED_TYPE_FLAG, channel_data.count);
+                }
+
+                uint32_t id = destination.map_id(channel_data.id);
+                if (id != Destination::NO_ID && is.ensure(value_size)) {
+                    os << CAChannelData(id, channel_data.count, channel_data.type);
+                    os.write(is.position(), value_size);
+                    os.pad_align(alignment, 0);
+                    generations[id] = Generation{data_msg.seq_no, seq_no, true};
+                    count++;
+                }
+
+                is += value_size;
+                is.pos_align(alignment, 0);
+            }
+
+            auto end_pos = os.position();
+            os.position(count_pos);
+            os << count;
+            os.position(end_pos);
+            data_entries += count;
+        }
+        else if (subheader.id == SubmessageType::CA_REFRESH_MESSAGE && data_pos && is.ensure(CARefreshMessage::size)) {
+            CARefreshMessage refresh_msg;
+            is >> refresh_msg;
+
+            auto refresh_pos = os.position();
+            auto prev_subheader_pos = last_subheader_pos;
+            auto prev_id = last_id;
+            begin_submessage(SubmessageType::CA_REFRESH_MESSAGE);
+            uint16_t count = 0;
+            os << CARefreshMessage(count);
+            auto count_pos = os.position() - CARefreshMessage::size;
+
+            for (uint16_t i = 0; i < refresh_msg.channel_count && is.ensure(CAChannelRefresh::size); i++) {
+                CAChannelRefresh refresh;
+                is >> refresh;
+
+                // only values known to the destination
+                uint32_t id = destination.map_id(refresh.id);
+                if (id != Destination::NO_ID && generations[id].valid && generations[id].source == refresh.generation) {
+                    os << CAChannelRefresh(id, generations[id].local, refresh.value_hash);
+                    count++;
+                }
+            }
+
+            if (count) {
+                auto end_pos = os.position();
+                os.position(count_pos);
+                os << CARefreshMessage(count);
+                os.position(end_pos);
+                os.pad_align(alignment, 0);
+                data_entries += count;
+            } else {
+                os.position(refresh_pos);
+                last_subheader_pos = prev_subheader_pos;
+                last_id = prev_id;
+            }
+        }
+        else if (subheader.id == SubmessageType::TIMESTAMP_MESSAGE && is.ensure(TimestampMessage::size)) {
+            close_data();
+            auto timestamp_in_pos = is.position();
+            TimestampMessage timestamp_msg;
+            is >> timestamp_msg;
+
+            // telemetry of the preceding data submessage only
+            if (data_sent) {
+                begin_submessage(SubmessageType::TIMESTAMP_MESSAGE);
+                auto timestamp_pos = os.position();
+                if (prepare_offset == std::size_t(timestamp_in_pos - in)) {
+                    out_prepare_offset = std::size_t(timestamp_pos - out);
+                }
+                os << timestamp_msg;
+
+                uint16_t count = 0;
+                for (uint16_t i = 0; i < timestamp_msg.channel_count && is.ensure(ChannelAge::size); i++) {
+                    ChannelAge age;
+                    is >> age;
+                    uint32_t id = destination.map_id(age.channel_id);
+                    if (id != Destination::NO_ID) {
+                        os << ChannelAge(id, age.queue_age);
+                        count++;
+                    }
+                }
+                os.pad_align(alignment, 0);
+
+                auto end_pos = os.position();
+                os.position(timestamp_pos);
+                timestamp_msg.channel_count = count;
+                os << timestamp_msg;
+                os.position(end_pos);
+            }
+        }
+        else if (subheader.id == SubmessageType::CA_FRAG_DATA_MESSAGE && is.ensure(CAFragDataMessage::size)) {
+            close_data();
+            CAFragDataMessage frag_msg;
+            is >> frag_msg;
+
+            uint32_t id = destination.map_id(frag_msg.channel_id);
+            if (id != Destination::NO_ID && is.ensure(frag_msg.fragment_size)) {
+                bool known = true;
+                uint16_t local_seq_no = seq_no;
+                if (frag_msg.fragment_seq_no == 0) {
+                    // a transfer takes its seq_no when started
+                    seq_no++;
+                    transfers.push_back(Transfer{frag_msg.seq_no, local_seq_no});
+                    if (transfers.size() > MAX_TRANSFERS) {
+                        transfers.pop_front();
+                    }
+                    generations[id] = Generation{frag_msg.seq_no, local_seq_no, true};
+                } else {
+                    auto it = std::find_if(transfers.rbegin(), transfers.rend(),
+                                           [&frag_msg](const Transfer& t) { return t.source == frag_msg.seq_no; });
+                    known = (it != transfers.rend());
+                    if (known) {
+                        local_seq_no = it->local;
+                    }
+                }
+
+                if (known) {
+                    begin_submessage(SubmessageType::CA_FRAG_DATA_MESSAGE);
+                    frag_msg.seq_no = local_seq_no;
+                    frag_msg.channel_id = id;
+                    os << frag_msg;
+                    os.write(is.position(), frag_msg.fragment_size);
+                    os.pad_align(alignment, 0);
+                }
+            }
+        }
+        else if (subheader.id == SubmessageType::CA_DELTA_DATA_MESSAGE && is.ensure(CADeltaDataMessage::size)) {
+            close_data();
+            CADeltaDataMessage delta_msg;
+            is >> delta_msg;
+
+            // applies only on top of a value known to the destination
+            uint32_t id = destination.map_id(delta_msg.channel_id);
+            if (id != Destination::NO_ID && generations[id].valid && generations[id].source == delta_msg.base_generation &&
+                payload_end >= is.position()) {
+                begin_submessage(SubmessageType::CA_DELTA_DATA_MESSAGE);
+                uint16_t source_seq_no = delta_msg.seq_no;
+                delta_msg.seq_no = seq_no;
+                delta_msg.base_generation = generations[id].local;
+                delta_msg.channel_id = id;
+                os << delta_msg;
+                // ranges are copied as they are
+                os.write(is.position(), std::size_t(payload_end - is.position()));
+                os.pad_align(alignment, 0);
+
+                generations[id] = Generation{source_seq_no, seq_no, true};
+                seq_no++;
+            }
+        }
+        else if (subheader.id == SubmessageType::BEACON_MESSAGE && is.ensure(BeaconMessage::size)) {
+            close_data();
+            BeaconMessage beacon_msg;
+            is >> beacon_msg;
+
+            // report last used seq_no of the destination stream
+            begin_submessage(SubmessageType::BEACON_MESSAGE);
+            os << BeaconMessage(uint16_t(seq_no - 1), beacon_msg.queue_depth, beacon_msg.startup_time);
+            os.pad_align(alignment, 0);
+        }
+
+        if (subheader.bytes_to_next_header == 0 || !is.try_position(payload_end)) {
+            break;
+        }
+    }
+    close_data();
+
+    if (!last_subheader_pos) {
+        return 0;
+    }
+
+    // the last submessage extends until the end of the message
+    auto end_pos = os.position();
+    os.position(last_subheader_pos);
+    os << SubmessageHeader(last_id, SubmessageFlag::LittleEndian, 0);
+
+    prepare_offset = out_prepare_offset;
+    return std::size_t(end_pos - out);
+}
+
+}
@@ -39,6 +39,7 @@ void usage()
               << "  -r <seconds>  : Runtime in seconds, defaults to forever\n"
               << "  -c <filename> : Set configuration filename, defaults to '" << edi::EPICS_DIODE_CONFIG_FILENAME << "'\n"
               << "  -i <address>  : Only listen on specified address, defaults listens on all addresses.'\n"
+              << "  -D <name>     : Receive channel subset of the destination, defaults to all the channels\n"
               << "\n"
               << "example: " << EXECNAME << "\n"
               << std::endl;
@@ -58,9 +59,10 @@ int main (int argc, char *argv[])
         double runtime = 0.0; // Defaults to forever.
         std::string config_filename = edi::EPICS_DIODE_CONFIG_FILENAME;
         std::string listening_address = edi::EPICS_DIODE_DEFAULT_LISTENING_ADDRESS;
+        std::string destination;
 
         int opt;
-        while ((opt = getopt(argc, argv, ":hVdr:c:i:")) != -1) {
+        while ((opt = getopt(argc, argv, ":hVdr:c:i:D:")) != -1) {
             switch (opt) {
             case 'h':
                 usage();
@@ -94,6 +96,9 @@ int main (int argc, char *argv[])
             case 'i':
                 listening_address = optarg;
                 break;
+            case 'D':
+                destination = optarg;
+                break;
             case '?':
                 std::cerr << "Unrecognized option: '" << (char)optopt << "'. ('" << EXECNAME << " -h' for help.)" << std::endl;
                 return 1;
@@ -125,6 +130,9 @@ int main (int argc, char *argv[])
 
         // Read configuration file.
         auto config = edi::get_configuration(config_filename);
+        if (!destination.empty()) {
+            config = edi::get_destination_configuration(config, destination);
+        }
 
         // Prepare flat channel names
         auto flat_channel_name = config.create_flat_channel_name_vector();
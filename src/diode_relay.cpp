@@ -0,0 +1,162 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <iostream>
+#include <string>
+
+#include <epicsStdlib.h>
+#include <epicsGetopt.h>
+#include <epicsVersion.h>
+
+#include <epics-diode/config.h>
+#include <epics-diode/logger.h>
+#include <epics-diode/relay.h>
+#include <epics-diode/transport.h>
+#include <epics-diode/version.h>
+#include <epics-diode/utils.h>
+
+namespace edi = epics_diode;
+
+namespace {
+
+char const* const EXECNAME("diode_relay");
+
+void usage()
+{
+    std::cerr << "\nUsage: " << EXECNAME << " [options] [<send address[:port]>...]\n"
+              << "\n"
+              << "options:\n"
+              << "  -h            : Help: Print this message\n"
+              << "  -V            : Print version and exit\n"
+              << "  -d            : Enable debug output\n"
+              << "  -r <seconds>  : Runtime in seconds, defaults to forever\n"
+              << "  -c <filename> : Set configuration filename, defaults to '" << edi::EPICS_DIODE_CONFIG_FILENAME << "'\n"
+              << "  -p <port>     : Receive port, defaults to " << edi::EPICS_DIODE_DEFAULT_PORT << "\n"
+              << "  -i <address>  : Only listen on specified address, defaults listens on all addresses.\n"
+              << "  -D <name>     : Relay only the channel subset of the destination, defaults to all the channels\n"
+              << "  -b <MB/s>     : Send rate-limit, defaults to 'rate_limit_mbs' of the configuration\n"
+              << "\n"
+              << "The send address can be omitted if a destination is given, its address is used.\n"
+              << "\n"
+              << "example: " << EXECNAME << " 192.168.13.8:" << edi::EPICS_DIODE_DEFAULT_PORT << "\n"
+              << std::endl;
+}
+
+}
+
+
+int main (int argc, char *argv[])
+{
+    // Configure stdout buffering.
+    LINE_BUFFER(stdout);
+
+    try {
+        int port = edi::EPICS_DIODE_DEFAULT_PORT;
+        int debug_level = 0;
+        double runtime = 0.0; // Defaults to forever.
+        std::string config_filename = edi::EPICS_DIODE_CONFIG_FILENAME;
+        std::string listening_address = edi::EPICS_DIODE_DEFAULT_LISTENING_ADDRESS;
+        std::string destination;
+        long rate_limit_mbs = -1;   // Defaults to configuration.
+
+        int opt;
+        while ((opt = getopt(argc, argv, ":hVdr:c:p:i:D:b:")) != -1) {
+            switch (opt) {
+            case 'h':
+                usage();
+                return 0;
+            case 'V':
+            {
+                std::cout << EXECNAME << ' '
+                          << EPICS_DIODE_MAJOR_VERSION << '.'
+                          << EPICS_DIODE_MINOR_VERSION << '.'
+                          << EPICS_DIODE_MAINTENANCE_VERSION
+                          << ((EPICS_DIODE_DEVELOPMENT_FLAG) ? "-SNAPSHOT" : "") << std::endl;
+                std::cout << "Base " << EPICS_VERSION_FULL << std::endl;
+                return 0;
+            }
+            case 'd':
+                debug_level++;
+                break;
+            case 'r':
+            {
+                double temp;
+                if ((epicsScanDouble(optarg, &temp)) != 1) {
+                    std::cerr << "'" << optarg << "' is not a valid duration value - ignored. ('" << EXECNAME << " -h' for help.)" << std::endl;
+                } else {
+                    runtime = temp;
+                }
+                break;
+            }
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 'p':
+            {
+                unsigned long temp;
+                if ((epicsScanULong(optarg, &temp, 10)) != 1) {
+                    std::cerr << "'" << optarg << "' is not a valid port value - ignored. ('" << EXECNAME << " -h' for help.)" << std::endl;
+                } else {
+                    port = temp;
+                }
+                break;
+            }
+            case 'i':
+                listening_address = optarg;
+                break;
+            case 'D':
+                destination = optarg;
+                break;
+            case 'b':
+            {
+                unsigned long temp;
+                if ((epicsScanULong(optarg, &temp, 10)) != 1) {
+                    std::cerr << "'" << optarg << "' is not a valid rate-limit value - ignored. ('" << EXECNAME << " -h' for help.)" << std::endl;
+                } else {
+                    rate_limit_mbs = (long)temp;
+                }
+                break;
+            }
+            case '?':
+                std::cerr << "Unrecognized option: '" << (char)optopt << "'. ('" << EXECNAME << " -h' for help.)" << std::endl;
+                return 1;
+            case ':':
+                std::cerr << "Option '" << (char)optopt << "' requires an argument. ('" << EXECNAME << " -h' for help.)" << std::endl;
+                return 1;
+            default :
+                usage();
+                return 1;
+            }
+        }
+
+        // Read send address, only one remaining argument is expected (none if a destination is relayed).
+        if ((argc - optind) > 1 || ((argc - optind) == 0 && destination.empty()))
+        {
+            std::cerr << "No or more than one send address specified. ('" << EXECNAME << " -h' for help.)" << std::endl;
+            return 1;
+        }
+
+        // Set log level.
+        edi::Logger::set_default_log_level(edi::LogLevel::from_verbosity(debug_level));
+
+        // Read configuration file.
+        auto config = edi::get_configuration(config_filename);
+        if (rate_limit_mbs < 0) {
+            rate_limit_mbs = config.rate_limit_mbs;
+        }
+
+        // Initialize socket subsystem.
+        edi::SocketContext socketContext;
+
+        // Run relay.
+        std::string send_address = (optind < argc) ? argv[optind] : "";
+        edi::Relay(config, port, listening_address, send_address, destination, uint32_t(rate_limit_mbs)).run(runtime);
+
+        return 0;
+    } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
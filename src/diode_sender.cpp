@@ -27,7 +27,7 @@ char const* const EXECNAME("diode_sender");
 
 void usage()
 {
-    std::cerr << "\nUsage: " << EXECNAME << " [options] <send address[:port]>...\n"
+    std::cerr << "\nUsage: " << EXECNAME << " [options] [<send address[:port]>...]\n"
               << "\n"
               << "options:\n"
               << "  -h            : Help: Print this message\n"
@@ -36,6 +36,8 @@ void usage()
               << "  -r <seconds>  : Runtime in seconds, defaults to forever\n"
               << "  -c <filename> : Set configuration filename, defaults to '" << edi::EPICS_DIODE_CONFIG_FILENAME << "'\n"
               << "\n"
+              << "The send address can be omitted if 'destinations' (channel subsets) are configured.\n"
+              << "\n"
               << "example: " << EXECNAME << " 192.168.12.8:" << edi::EPICS_DIODE_DEFAULT_PORT << "\n"
               << std::endl;
 }
@@ -97,24 +99,24 @@ int main (int argc, char *argv[])
             }
         }
 
-        // Read send address, only one remaining argument is expected.
-        if ((argc - optind) != 1)
-        {
-            std::cerr << "No or more than one send address specified. ('" << EXECNAME << " -h' for help.)" << std::endl;
-            return 1;
-        }
-
         // Set log level.
         edi::Logger::set_default_log_level(edi::LogLevel::from_verbosity(debug_level));
 
         // Read configuration file.
         auto config = edi::get_configuration(config_filename);
 
+        // Read send address, only one remaining argument is expected (none if only destinations are served).
+        if ((argc - optind) > 1 || ((argc - optind) == 0 && config.destinations.empty()))
+        {
+            std::cerr << "No or more than one send address specified. ('" << EXECNAME << " -h' for help.)" << std::endl;
+            return 1;
+        }
+
         // Initialize socket subsystem.
         edi::SocketContext socketContext;
 
         // Run sender.
-        std::string send_address = argv[optind];
+        std::string send_address = (optind < argc) ? argv[optind] : "";
         edi::Sender(config, send_address).run(runtime);
 
         return 0;
@@ -0,0 +1,197 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <epicsStdlib.h>
+#include <epicsGetopt.h>
+#include <epicsVersion.h>
+
+#include <epics-diode/config.h>
+#include <epics-diode/logger.h>
+#include <epics-diode/protocol.h>
+#include <epics-diode/sender.h>
+#include <epics-diode/transport.h>
+#include <epics-diode/version.h>
+#include <epics-diode/utils.h>
+
+#include <epics-diode/pva/sender.h>
+
+namespace edi = epics_diode;
+
+namespace {
+
+char const* const EXECNAME("diode_unified_sender");
+char const* const PVA_CONFIG_FILENAME("pvadiode.json");
+
+void usage()
+{
+    std::cerr << "\nUsage: " << EXECNAME << " [options] <CA send address[:port]> <PVA send address[:port]>\n"
+              << "\n"
+              << "options:\n"
+              << "  -h            : Help: Print this message\n"
+              << "  -V            : Print version and exit\n"
+              << "  -d            : Enable debug output\n"
+              << "  -r <seconds>  : Runtime in seconds, defaults to forever\n"
+              << "  -c <filename> : Set CA configuration filename, defaults to '" << edi::EPICS_DIODE_CONFIG_FILENAME << "'\n"
+              << "  -p <filename> : Set PVA configuration filename, defaults to '" << PVA_CONFIG_FILENAME << "'\n"
+              << "  -b <MB/s>     : Send rate-limit of the shared transport, defaults to the sum of 'rate_limit_mbs'\n"
+              << "\n"
+              << "The bandwidth is split in the ratio of 'rate_limit_mbs' of the configurations,\n"
+              << "share not used by one protocol is used by the other.\n"
+              << "\n"
+              << "example: " << EXECNAME << " 192.168.12.8:" << edi::EPICS_DIODE_DEFAULT_PORT
+              << " 192.168.12.8:" << edi::EPICS_PVADIODE_DEFAULT_PORT << "\n"
+              << std::endl;
+}
+
+}
+
+
+int main (int argc, char *argv[])
+{
+    // Configure stdout buffering.
+    LINE_BUFFER(stdout);
+
+    try {
+        int debug_level = 0;
+        double runtime = 0.0; // Defaults to forever.
+        std::string config_filename = edi::EPICS_DIODE_CONFIG_FILENAME;
+        std::string pva_config_filename = PVA_CONFIG_FILENAME;
+        long rate_limit_mbs = -1;   // Defaults to the sum of the configurations.
+
+        int opt;
+        while ((opt = getopt(argc, argv, ":hVdr:c:p:b:")) != -1) {
+            switch (opt) {
+            case 'h':
+                usage();
+                return 0;
+            case 'V':
+            {
+                std::cout << EXECNAME << ' '
+                          << EPICS_DIODE_MAJOR_VERSION << '.'
+                          << EPICS_DIODE_MINOR_VERSION << '.'
+                          << EPICS_DIODE_MAINTENANCE_VERSION
+                          << ((EPICS_DIODE_DEVELOPMENT_FLAG) ? "-SNAPSHOT" : "") << std::endl;
+                std::cout << "Base " << EPICS_VERSION_FULL << std::endl;
+                return 0;
+            }
+            case 'd':
+                debug_level++;
+                break;
+            case 'r':
+            {
+                double temp;
+                if ((epicsScanDouble(optarg, &temp)) != 1) {
+                    std::cerr << "'" << optarg << "' is not a valid duration value - ignored. ('" << EXECNAME << " -h' for help.)" << std::endl;
+                } else {
+                    runtime = temp;
+                }
+                break;
+            }
+            case 'c':
+                config_filename = optarg;
+                break;
+            case 'p':
+                pva_config_filename = optarg;
+                break;
+            case 'b':
+            {
+                unsigned long temp;
+                if ((epicsScanULong(optarg, &temp, 10)) != 1) {
+                    std::cerr << "'" << optarg << "' is not a valid rate-limit value - ignored. ('" << EXECNAME << " -h' for help.)" << std::endl;
+                } else {
+                    rate_limit_mbs = (long)temp;
+                }
+                break;
+            }
+            case '?':
+                std::cerr << "Unrecognized option: '" << (char)optopt << "'. ('" << EXECNAME << " -h' for help.)" << std::endl;
+                return 1;
+            case ':':
+                std::cerr << "Option '" << (char)optopt << "' requires an argument. ('" << EXECNAME << " -h' for help.)" << std::endl;
+                return 1;
+            default :
+                usage();
+                return 1;
+            }
+        }
+
+        // Read send addresses, one per protocol.
+        if ((argc - optind) != 2)
+        {
+            std::cerr << "Two send addresses (CA and PVA) expected. ('" << EXECNAME << " -h' for help.)" << std::endl;
+            return 1;
+        }
+
+        // Set log level.
+        edi::Logger::set_default_log_level(edi::LogLevel::from_verbosity(debug_level));
+
+        // Read configuration files.
+        auto config = edi::get_configuration(config_filename);
+        auto pva_config = edi::get_configuration(pva_config_filename);
+
+        // Rate-limits of the configurations set the bandwidth split, no limit (0) takes an equal share.
+        double weight = config.rate_limit_mbs;
+        double pva_weight = pva_config.rate_limit_mbs;
+        if (!weight || !pva_weight) {
+            weight = pva_weight = 1.0;
+        }
+        if (rate_limit_mbs < 0) {
+            rate_limit_mbs = (config.rate_limit_mbs && pva_config.rate_limit_mbs) ?
+                long(config.rate_limit_mbs) + long(pva_config.rate_limit_mbs) : 0;
+        }
+
+        // Initialize socket subsystem.
+        edi::SocketContext socketContext;
+
+        // Shared transport, one rate-limit for both protocols.
+        edi::UDPSender sender({}, uint32_t(rate_limit_mbs));
+        edi::TransmitQueue transmitter(sender, std::max(config.transmit_buffers, pva_config.transmit_buffers),
+                                       edi::MAX_MESSAGE_SIZE);
+
+        edi::Sender ca_sender(config, argv[optind], transmitter, weight);
+        edi::pva::Sender pva_sender(pva_config, argv[optind + 1], transmitter, pva_weight);
+        transmitter.start();
+
+        // Run senders, PVA in its own thread; a failing sender stops the other.
+        std::atomic<bool> stop{false};
+        std::exception_ptr pva_error;
+        std::thread pva_thread([&pva_sender, runtime, &stop, &pva_error]() {
+            try {
+                pva_sender.run(runtime, &stop);
+            } catch (...) {
+                pva_error = std::current_exception();
+                stop.store(true);
+            }
+        });
+
+        std::exception_ptr ca_error;
+        try {
+            ca_sender.run(runtime, &stop);
+        } catch (...) {
+            ca_error = std::current_exception();
+            stop.store(true);
+        }
+        pva_thread.join();
+
+        if (ca_error) {
+            std::rethrow_exception(ca_error);
+        }
+        if (pva_error) {
+            std::rethrow_exception(pva_error);
+        }
+
+        return 0;
+    } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
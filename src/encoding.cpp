@@ -0,0 +1,144 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <cadef.h>
+
+#include <epics-diode/encoding.h>
+
+namespace epics_diode {
+
+namespace {
+
+void narrow_to_float(const double* in, float* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = float(in[i]);
+    }
+}
+
+void widen_to_double(const float* in, double* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = double(in[i]);
+    }
+}
+
+// Reserved int16 value of NaN, the quantized range is symmetric.
+constexpr int16_t INT16_NAN = std::numeric_limits<int16_t>::min();
+
+// out = round((in - offset) / scale), saturated to int16 range (+-Inf included), NaN to INT16_NAN
+void quantize_int16(const double* in, int16_t* out, std::size_t n, double scale, double offset) {
+    constexpr double min = -double(std::numeric_limits<int16_t>::max());
+    constexpr double max = std::numeric_limits<int16_t>::max();
+    const double inv_scale = 1.0 / scale;
+    for (std::size_t i = 0; i < n; i++) {
+        double v = (in[i] - offset) * inv_scale;
+        bool nan = (v != v);
+        // clamped before the conversion, out of range values do not convert
+        double q = std::nearbyint(std::min(std::max(nan ? 0.0 : v, min), max));
+        out[i] = nan ? INT16_NAN : int16_t(q);
+    }
+}
+
+inline double dequantize(int16_t in, double scale, double offset) {
+    return (in == INT16_NAN) ? std::numeric_limits<double>::quiet_NaN() : in * scale + offset;
+}
+
+void dequantize_int16(const int16_t* in, double* out, std::size_t n, double scale, double offset) {
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = dequantize(in[i], scale, offset);
+    }
+}
+
+// wrapping differences, losslessly reversible
+void delta_encode(int16_t* values, std::size_t n) {
+    for (std::size_t i = n; i-- > 1; ) {
+        values[i] = int16_t(uint16_t(values[i]) - uint16_t(values[i-1]));
+    }
+}
+
+void delta_decode(int16_t* values, std::size_t n) {
+    for (std::size_t i = 1; i < n; i++) {
+        values[i] = int16_t(uint16_t(values[i]) + uint16_t(values[i-1]));
+    }
+}
+
+}
+
+ValueEncoding::ValueEncoding(const ConfigChannel& config_channel) :
+    encoding(config_channel.encoding),
+    scale((config_channel.encoding_scale != 0) ? config_channel.encoding_scale : 1.0),
+    offset(config_channel.encoding_offset),
+    delta(config_channel.delta_encoding && config_channel.encoding == Encoding::int16)
+{
+}
+
+uint16_t ValueEncoding::encode(const void* dbr, long count, std::vector<uint8_t>& value) const
+{
+    auto* in = static_cast<const dbr_time_double*>(dbr);
+    auto n = std::size_t(std::max(count, 1L));
+
+    if (encoding == Encoding::float32) {
+        value.resize(dbr_size_n(DBR_TIME_FLOAT, count));
+        auto* out = reinterpret_cast<dbr_time_float*>(value.data());
+        out->status = in->status;
+        out->severity = in->severity;
+        out->stamp = in->stamp;
+        narrow_to_float(&in->value, &out->value, n);
+        return DBR_TIME_FLOAT;
+    } else {
+        value.resize(dbr_size_n(DBR_TIME_SHORT, count));
+        auto* out = reinterpret_cast<dbr_time_short*>(value.data());
+        out->status = in->status;
+        out->severity = in->severity;
+        out->stamp = in->stamp;
+        out->RISC_pad = 0;
+        quantize_int16(&in->value, &out->value, n, scale, offset);
+        if (delta) {
+            delta_encode(&out->value, n);
+        }
+        return DBR_TIME_SHORT;
+    }
+}
+
+bool ValueEncoding::decode(uint16_t type, const void* data, long count, std::vector<uint8_t>& value) const
+{
+    auto n = std::size_t(std::max(count, 1L));
+
+    value.resize(dbr_size_n(DBR_TIME_DOUBLE, count));
+    auto* out = reinterpret_cast<dbr_time_double*>(value.data());
+    out->RISC_pad = 0;
+
+    if (type == DBR_TIME_FLOAT && encoding == Encoding::float32) {
+        auto* in = static_cast<const dbr_time_float*>(data);
+        out->status = in->status;
+        out->severity = in->severity;
+        out->stamp = in->stamp;
+        widen_to_double(&in->value, &out->value, n);
+        return true;
+    } else if (type == DBR_TIME_SHORT && encoding == Encoding::int16) {
+        auto* in = static_cast<const dbr_time_short*>(data);
+        out->status = in->status;
+        out->severity = in->severity;
+        out->stamp = in->stamp;
+        if (delta) {
+            // decode in place of the output buffer, then expand (backwards, since int16 -> double)
+            auto* values = reinterpret_cast<int16_t*>(&out->value);
+            std::copy(&in->value, &in->value + n, values);
+            delta_decode(values, n);
+            for (std::size_t i = n; i-- > 0; ) {
+                (&out->value)[i] = dequantize(values[i], scale, offset);
+            }
+        } else {
+            dequantize_int16(&in->value, &out->value, n, scale, offset);
+        }
+        return true;
+    }
+    return false;
+}
+
+}
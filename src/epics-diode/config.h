@@ -6,6 +6,7 @@
 #ifndef EPICS_DIODE_CONFIG_H
 #define EPICS_DIODE_CONFIG_H
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <string>
@@ -17,10 +18,66 @@ namespace epics_diode {
 const char* const EPICS_DIODE_CONFIG_FILENAME("diode.json");
 
 
+// Channel priority class (of the sender update queue).
+enum class Priority : uint8_t {
+    high,
+    normal,
+    low
+};
+
+// Scheduling of the priority classes.
+enum class PriorityScheduling : uint8_t {
+    strict,     // lower classes are sent only when higher classes are empty
+    weighted    // weighted-fair sharing of bandwidth (4:2:1), no class starves
+};
+
+// Duplicate value suppression mode (of monitored channels).
+enum class DedupMode : uint8_t {
+    none,       // send every update
+    dbr,        // suppress identical DBR values (timestamp included)
+    value       // suppress unchanged values (status and severity included), timestamp is ignored
+};
+
+// Array downsampling mode, applied to bins of 'array_stride' elements.
+enum class ArrayBinning : uint8_t {
+    none,       // first element of each bin (decimation)
+    min,
+    max,
+    mean
+};
+
+// Encoding of DBR_TIME_DOUBLE values (precision narrowing).
+enum class Encoding : uint8_t {
+    none,
+    float32,    // double -> float
+    int16       // value = int16 * encoding_scale + encoding_offset
+};
+
 struct ConfigChannel {
     std::string channel_name;
     std::vector<std::string> extra_fields;
     std::vector<std::string> polled_fields;
+    Priority priority = Priority::normal;
+    DedupMode dedup = DedupMode::none;
+    double deadband_abs = 0.0;                 // absolute deadband, 0 to disable
+    double deadband_rel = 0.0;                 // relative deadband (fraction of the last sent value), 0 to disable
+    bool deadband_per_element = false;         // apply deadband to each array element, otherwise to the entire array
+    std::string ca_filter;                     // CA server-side channel filter(s) JSON, e.g. '{"sync":{"m":"while","s":"on"}}'
+    double ca_dbnd = 0.0;                      // CA server-side absolute deadband ("dbnd" filter), 0 to disable
+    uint32_t ca_dec = 0;                       // CA server-side decimation ("dec" filter), 0 to disable
+    uint32_t event_mask = 0;                   // CA subscription event mask (DBE_*), 0 for default
+    double min_update_period = 0.0;            // channel minimum update period (max. update rate), 0 for no limit
+    uint32_t array_offset = 0;                 // array region of interest, first element
+    uint32_t array_count = 0;                  // array region of interest, number of elements, 0 for all
+    uint32_t array_stride = 1;                 // array decimation (binning) factor
+    ArrayBinning array_binning = ArrayBinning::none;
+    Encoding encoding = Encoding::none;
+    double encoding_scale = 1.0;
+    double encoding_offset = 0.0;
+    bool delta_encoding = false;               // differences of consecutive array elements (int16 encoding only)
+    bool array_delta = false;                  // send only changed parts of arrays
+    uint32_t keyframe_interval = 16;           // number of partial (delta) updates between full updates
+    std::string group;                         // channel group, used to select channels of destinations
 
     ConfigChannel() {
     }
@@ -31,6 +88,17 @@ struct ConfigChannel {
     }
 };
 
+// Receiver (destination) of a channel subset, sent as a separate message stream.
+struct ConfigDestination {
+    std::string name;
+    std::string address;                       // send address list
+    std::vector<std::string> channels;         // channel name patterns ('*' and '?' wildcards)
+    std::vector<std::string> groups;           // channel groups
+
+    // Record channel (with all its fields) is included if it matches any of the patterns or groups.
+    bool includes(const ConfigChannel& channel) const;
+};
+
 namespace {
 
 uint64_t fnv1a_hash(const void* data, size_t size,
@@ -58,13 +126,32 @@ uint64_t hash_string(const std::string& s) {
 
 }  // namespace
 
+// Shortest update period of a sender.
+constexpr double MIN_UPDATE_PERIOD = 0.025;
+
 struct Config {
     std::size_t hash = 0;                      // 0 indicates "do not check"
     double min_update_period = 0.1;            // 0.1s
     double polled_fields_update_period = 5.0;  // 5.0s
     double heartbeat_period = 15.0;            // 15s
+    double beacon_period = 0.1;                // 0.1s, 0 to disable link beacons
     uint32_t rate_limit_mbs = 64;              // 64Mb/s, suitable for 1Gb network
+    double heartbeat_bandwidth_share = 0.1;    // 10% of rate_limit_mbs for heartbeat updates
+    double fragment_bandwidth_share = 0.5;     // 50% of rate_limit_mbs for fragmented (large) values
+    double full_refresh_period = 60.0;         // 60s, unchanged values re-sent in full, 0 to always re-send in full
+    bool latency_telemetry = false;            // send timestamps and channel queueing ages
+    bool variable_length_arrays = false;       // send only valid (NORD) array elements, requires CA V4.13 servers
+    PriorityScheduling priority_scheduling = PriorityScheduling::strict;
+    bool immediate_flush = false;              // send high priority updates without waiting for min_update_period
+    double latency_budget = 0.0;               // max. queueing time of an update in seconds, 0 to send once per min_update_period
+    uint32_t transmit_buffers = 16;            // packet buffers queued to the transmit thread
+    bool preemptive_callbacks = false;         // CA events delivered by CA auxiliary threads, queued to the sender thread
+    uint32_t sender_shards = 1;                // channels partitioned across sender threads (CA contexts)
+    uint32_t connect_batch_size = 1000;        // CA channels created per update period at startup, 0 for all at once
+    std::string channel_cache;                 // file of last known channel types and counts, empty to disable
+    uint32_t reorder_window = 32;              // queued updates looked ahead to fill a packet, 0 to send in FIFO order only
     std::vector<ConfigChannel> channels;
+    std::vector<ConfigDestination> destinations;   // channel subsets, sent in addition to the entire configuration
 
     void update_hash()
     {
@@ -73,7 +160,17 @@ struct Config {
         hash = hash_combine(hash, hash_double(min_update_period));
         hash = hash_combine(hash, hash_double(polled_fields_update_period));
         hash = hash_combine(hash, hash_double(heartbeat_period));
+        hash = hash_combine(hash, hash_double(beacon_period));
         hash = hash_combine(hash, hash_uint32(rate_limit_mbs));
+        hash = hash_combine(hash, hash_double(heartbeat_bandwidth_share));
+        hash = hash_combine(hash, hash_double(fragment_bandwidth_share));
+        hash = hash_combine(hash, hash_double(full_refresh_period));
+        hash = hash_combine(hash, hash_uint32(latency_telemetry));
+        hash = hash_combine(hash, hash_uint32(variable_length_arrays));
+        hash = hash_combine(hash, hash_uint32(uint32_t(priority_scheduling)));
+        // sender-local tuning (immediate_flush, latency_budget, transmit_buffers, preemptive_callbacks,
+        // sender_shards, connect_batch_size, reorder_window) and channel_cache (a local file path) are not hashed
+        // destinations are hashed as their own configurations, see get_destination_configuration()
 
         for (auto &channel : channels) {
             hash = hash_combine(hash, hash_string(channel.channel_name));
@@ -83,9 +180,41 @@ struct Config {
             for (auto &field_name : channel.polled_fields) {
                 hash = hash_combine(hash, hash_string(field_name));
             }
+            hash = hash_combine(hash, hash_uint32(uint32_t(channel.priority)));
+            hash = hash_combine(hash, hash_uint32(uint32_t(channel.dedup)));
+            hash = hash_combine(hash, hash_double(channel.deadband_abs));
+            hash = hash_combine(hash, hash_double(channel.deadband_rel));
+            hash = hash_combine(hash, hash_uint32(channel.deadband_per_element));
+            hash = hash_combine(hash, hash_string(channel.ca_filter));
+            hash = hash_combine(hash, hash_double(channel.ca_dbnd));
+            hash = hash_combine(hash, hash_uint32(channel.ca_dec));
+            hash = hash_combine(hash, hash_uint32(channel.event_mask));
+            hash = hash_combine(hash, hash_double(channel.min_update_period));
+            hash = hash_combine(hash, hash_uint32(channel.array_offset));
+            hash = hash_combine(hash, hash_uint32(channel.array_count));
+            hash = hash_combine(hash, hash_uint32(channel.array_stride));
+            hash = hash_combine(hash, hash_uint32(uint32_t(channel.array_binning)));
+            hash = hash_combine(hash, hash_uint32(uint32_t(channel.encoding)));
+            hash = hash_combine(hash, hash_double(channel.encoding_scale));
+            hash = hash_combine(hash, hash_double(channel.encoding_offset));
+            hash = hash_combine(hash, hash_uint32(channel.delta_encoding));
+            hash = hash_combine(hash, hash_uint32(channel.array_delta));
+            hash = hash_combine(hash, hash_uint32(channel.keyframe_interval));
         }
     }
 
+    // Update period of the sender, 'min_update_period' limited to MIN_UPDATE_PERIOD.
+    double effective_update_period() const
+    {
+        return std::max(min_update_period, MIN_UPDATE_PERIOD);
+    }
+
+    // Period of the link beacons, sent at most once per update period; 0 if disabled.
+    double effective_beacon_period() const
+    {
+        return (beacon_period > 0) ? std::max(beacon_period, effective_update_period()) : 0.0;
+    }
+
     std::size_t total_channel_count() const
     {
         std::size_t result = 0;
@@ -120,6 +249,9 @@ struct Config {
 
 Config get_configuration(const std::string& filename);
 
+// Configuration of the channel subset of a destination (with its own hash), throws if there is no such destination.
+Config get_destination_configuration(const Config& config, const std::string& destination);
+
 }
 
 #endif
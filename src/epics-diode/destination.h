@@ -0,0 +1,86 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#ifndef EPICS_DIODE_DESTINATION_H
+#define EPICS_DIODE_DESTINATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <osiSock.h>
+
+#include <epics-diode/config.h>
+
+namespace epics_diode {
+
+// Destination of a channel subset (see Config::destinations), with its own configuration hash and channel ids.
+struct Destination
+{
+    static constexpr uint32_t NO_ID = std::numeric_limits<uint32_t>::max();
+
+    std::string name;
+    uint64_t hash = 0;
+    std::vector<osiSockAddr> addresses;
+    std::vector<uint32_t> ids;          // (global) channel id -> destination channel id, NO_ID if not included
+    uint32_t channel_count = 0;
+
+    // Record channels are included with all their fields, ids follow the order of the configuration.
+    Destination(const Config& config, const ConfigDestination& config_destination);
+
+    inline uint32_t map_id(uint32_t id) const {
+        if (id < ids.size()) {
+            return ids[id];
+        }
+        return NO_ID;
+    }
+};
+
+// Message stream of a destination (of one shard). Messages of the entire configuration are rewritten
+// to the channels of the destination, with its channel ids and its own seq_no sequence; value generations
+// (seq_no of the message that carried a value) are translated, so refreshes and deltas stay valid.
+class DestinationStream
+{
+public:
+    DestinationStream(const Destination& destination, std::size_t lane) :
+        lane(lane),
+        destination(destination),
+        generations(destination.channel_count)
+    {
+    }
+
+    // Rewrites 'length' bytes of 'in' to 'out' (both start with a header), returns the length of
+    // the rewritten message, 0 if nothing is left to be sent. 'prepare_offset' is updated accordingly.
+    std::size_t rewrite(uint8_t* in, std::size_t length, uint8_t* out, std::size_t& prepare_offset);
+
+    const std::size_t lane;         // transmit lane
+
+private:
+    // zero-initialized by the vector
+    struct Generation {
+        uint16_t source;            // seq_no of the message of the entire configuration
+        uint16_t local;             // seq_no of the destination message
+        bool valid;
+    };
+
+    struct Transfer {
+        uint16_t source;
+        uint16_t local;
+    };
+
+    static constexpr std::size_t MAX_TRANSFERS = 16;    // fragmented transfers in progress, oldest are forgotten
+
+    const Destination& destination;
+    uint16_t seq_no = 0;
+    std::vector<Generation> generations;    // per destination channel
+    std::deque<Transfer> transfers;
+};
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#ifndef EPICS_DIODE_ENCODING_H
+#define EPICS_DIODE_ENCODING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <epics-diode/config.h>
+
+namespace epics_diode {
+
+// Set in CAChannelData/CAFragDataMessage 'type' when the value is encoded,
+// the remaining bits hold the DBR type of the encoded data.
+constexpr uint16_t ENCODED_TYPE_FLAG = 0x8000;
+
+// Precision narrowing (quantization) of DBR_TIME_DOUBLE values.
+// The kernels are plain loops over contiguous arrays, to be vectorized by the compiler.
+class ValueEncoding {
+public:
+    ValueEncoding() {}
+    explicit ValueEncoding(const ConfigChannel& config_channel);
+
+    inline bool enabled() const {
+        return encoding != Encoding::none;
+    }
+
+    // Encodes DBR_TIME_DOUBLE 'dbr' of 'count' elements into 'value', returns the DBR type of the encoded data.
+    uint16_t encode(const void* dbr, long count, std::vector<uint8_t>& value) const;
+
+    // Decodes 'data' of (encoded) DBR 'type' back to DBR_TIME_DOUBLE, returns false on unexpected type.
+    bool decode(uint16_t type, const void* data, long count, std::vector<uint8_t>& value) const;
+
+private:
+    Encoding encoding = Encoding::none;
+    double scale = 1.0;
+    double offset = 0.0;
+    bool delta = false;
+};
+
+}
+
+#endif
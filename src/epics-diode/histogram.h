@@ -0,0 +1,62 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#ifndef EPICS_DIODE_HISTOGRAM_H
+#define EPICS_DIODE_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace epics_diode {
+
+// HDR-style (log-linear) histogram of non-negative integer values, e.g. latencies in microseconds.
+// Each power of two range is split into 2^SUB_BUCKET_BITS linear buckets, i.e. ~3% value precision,
+// with constant memory footprint and O(1) recording.
+class Histogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr unsigned MAX_VALUE_BITS = 40;   // ~12 days in microseconds
+
+    Histogram();
+
+    void record(int64_t value);
+    void reset();
+
+    inline uint64_t count() const {
+        return total_count;
+    }
+
+    inline int64_t min() const {
+        return total_count ? min_value : 0;
+    }
+
+    inline int64_t max() const {
+        return total_count ? max_value : 0;
+    }
+
+    double mean() const;
+
+    // Returns value at given percentile (0 - 100).
+    int64_t percentile(double p) const;
+
+    // Returns one-line summary, values divided by 'scale' (e.g. 1000 for us -> ms).
+    std::string summary(double scale) const;
+
+private:
+    static std::size_t bucket_index(uint64_t value);
+    static uint64_t bucket_value(std::size_t index);
+
+    std::vector<uint64_t> buckets;
+    uint64_t total_count = 0;
+    int64_t min_value = 0;
+    int64_t max_value = 0;
+    double sum = 0;
+};
+
+}
+
+#endif
@@ -180,17 +180,19 @@ struct Header {
 
     std::array<uint8_t, 4> magic{};
     uint8_t version = 0;
-    std::array<uint8_t, 3> reserved{};
+    uint8_t stream_id = 0;            // sequence stream (sender shard)
+    std::array<uint8_t, 2> reserved{};
     std::uint64_t startup_time = 0;   //  time in milliseconds since the UNIX epoch, little-endian
     std::uint64_t config_hash = 0;    // configuration hash, little-endian
 
     /// Constructs empty (zeroed) header.
     constexpr Header() {}
     
-    /// Constructs valid (with magic and versions) header with given GUID and configuration hash
-    constexpr explicit Header(std::uint64_t startup_time, std::uint64_t config_hash) : 
+    /// Constructs valid (with magic and versions) header with given GUID, configuration hash and stream
+    constexpr explicit Header(std::uint64_t startup_time, std::uint64_t config_hash, uint8_t stream_id = 0) : 
         magic({ 0x70u, 0x76u, 0x41u, 0x43u }),
         version(VERSION),
+        stream_id(stream_id),
         startup_time(startup_time),
         config_hash(config_hash)
     {}
@@ -207,8 +209,12 @@ Serializer& operator>>(Serializer& buf, Header& h);
 
 struct SubmessageType {
     enum ids : uint8_t {
+        BEACON_MESSAGE = 1,
+        TIMESTAMP_MESSAGE = 2,
         CA_DATA_MESSAGE = 16,
-        CA_FRAG_DATA_MESSAGE = 17
+        CA_FRAG_DATA_MESSAGE = 17,
+        CA_REFRESH_MESSAGE = 18,
+        CA_DELTA_DATA_MESSAGE = 19
     };
 };
 
@@ -247,6 +253,68 @@ Serializer& operator>>(Serializer& buf, SubmessageHeader& h);
 
 
 
+struct BeaconMessage {
+    static constexpr std::size_t size = 16;
+
+    uint16_t seq_no = 0;            // last used seq_no, to detect lost messages
+    uint16_t reserved = 0;
+    uint32_t queue_depth = 0;       // number of updates pending on the sender side
+    uint64_t startup_time = 0;      // same as in the header, little-endian
+
+    constexpr BeaconMessage() {}
+
+    constexpr explicit BeaconMessage(uint16_t seq_no, uint32_t queue_depth, uint64_t startup_time) :
+        seq_no(seq_no),
+        queue_depth(queue_depth),
+        startup_time(startup_time)
+    {}
+};
+
+Serializer& operator<<(Serializer& buf, const BeaconMessage& m);
+Serializer& operator>>(Serializer& buf, BeaconMessage& m);
+
+
+
+// Latency telemetry, follows data submessage within the same message.
+struct TimestampMessage {
+    static constexpr std::size_t size = 20;
+
+    uint16_t channel_count = 0;     // number of ChannelAge entries to follow
+    uint16_t reserved = 0;
+    uint64_t send_time = 0;         // time in nanoseconds since the UNIX epoch, when sent, little-endian
+    uint32_t pacing_delay = 0;      // time in microseconds spent in rate-limiter before sending
+    uint32_t reserved2 = 0;
+    //ChannelAge channel_ages[channel_count];
+
+    constexpr TimestampMessage() {}
+
+    constexpr explicit TimestampMessage(uint16_t channel_count) :
+        channel_count(channel_count)
+    {}
+};
+
+Serializer& operator<<(Serializer& buf, const TimestampMessage& m);
+Serializer& operator>>(Serializer& buf, TimestampMessage& m);
+
+struct ChannelAge {
+    static constexpr std::size_t size = 8;
+
+    uint32_t channel_id = 0;
+    uint32_t queue_age = 0;         // time in microseconds from CA event to message assembly
+
+    constexpr ChannelAge() {}
+
+    constexpr explicit ChannelAge(uint32_t channel_id, uint32_t queue_age) :
+        channel_id(channel_id),
+        queue_age(queue_age)
+    {}
+};
+
+Serializer& operator<<(Serializer& buf, const ChannelAge& m);
+Serializer& operator>>(Serializer& buf, ChannelAge& m);
+
+
+
 
 
 struct CADataMessage {
@@ -299,6 +367,10 @@ Serializer& operator>>(Serializer& buf, CAChannelData& m);
 struct CAFragDataMessage {
     static constexpr std::size_t size = 16;
 
+    // all fragments but the last one are of this size (8-byte aligned)
+    static constexpr std::size_t max_fragment_size =
+        (MAX_MESSAGE_SIZE - Header::size - SubmessageHeader::size - size) & ~std::size_t(SubmessageHeader::alignment - 1);
+
     uint16_t seq_no = 0;    // must be same for all fragments
     uint16_t fragment_seq_no = 0;  
     uint32_t channel_id = 0;
@@ -324,6 +396,97 @@ struct CAFragDataMessage {
 Serializer& operator<<(Serializer& buf, const CAFragDataMessage& m);
 Serializer& operator>>(Serializer& buf, CAFragDataMessage& m);
 
+
+
+// Heartbeat of unchanged values, follows data submessage within the same message.
+struct CARefreshMessage {
+    static constexpr std::size_t size = 4;
+
+    uint16_t channel_count = 0;     // number of CAChannelRefresh entries to follow
+    uint16_t reserved = 0;
+    //CAChannelRefresh channels[channel_count];
+
+    constexpr CARefreshMessage() {}
+
+    constexpr explicit CARefreshMessage(uint16_t channel_count) :
+        channel_count(channel_count)
+    {}
+};
+
+Serializer& operator<<(Serializer& buf, const CARefreshMessage& m);
+Serializer& operator>>(Serializer& buf, CARefreshMessage& m);
+
+struct CAChannelRefresh {
+    static constexpr std::size_t size = 16;
+
+    uint32_t id = 0;
+    uint16_t generation = 0;        // seq_no of the message that carried the value
+    uint16_t reserved = 0;
+    uint64_t value_hash = 0;        // hash of the value (DBR data), little-endian
+
+    constexpr CAChannelRefresh() {}
+
+    constexpr explicit CAChannelRefresh(uint32_t id, uint16_t generation, uint64_t value_hash) :
+        id(id),
+        generation(generation),
+        value_hash(value_hash)
+    {}
+};
+
+Serializer& operator<<(Serializer& buf, const CAChannelRefresh& m);
+Serializer& operator>>(Serializer& buf, CAChannelRefresh& m);
+
+
+
+// Partial update of a channel value, applies on top of the value of 'base_generation'.
+struct CADeltaDataMessage {
+    static constexpr std::size_t size = 20;
+
+    uint16_t seq_no = 0;            // same sequence as CADataMessage
+    uint16_t base_generation = 0;   // seq_no of the message that carried the value (or delta) to be updated
+    uint32_t channel_id = 0;
+    uint32_t count = 0;
+    uint16_t type = 0;
+    uint16_t range_count = 0;       // number of CADeltaRange entries to follow
+    uint32_t reserved = 0;
+    //CADeltaRange ranges[range_count];
+
+    constexpr CADeltaDataMessage() {}
+
+    constexpr explicit CADeltaDataMessage(
+        uint16_t seq_no, uint16_t base_generation,
+        uint32_t channel_id, uint32_t count, uint16_t type,
+        uint16_t range_count) :
+        seq_no(seq_no),
+        base_generation(base_generation),
+        channel_id(channel_id),
+        count(count),
+        type(type),
+        range_count(range_count)
+    {}
+};
+
+Serializer& operator<<(Serializer& buf, const CADeltaDataMessage& m);
+Serializer& operator>>(Serializer& buf, CADeltaDataMessage& m);
+
+struct CADeltaRange {
+    static constexpr std::size_t size = 8;
+
+    uint32_t offset = 0;            // byte offset within dbr value, 8-byte aligned
+    uint32_t size_bytes = 0;
+    //uint8_t data[size_bytes];     // always 8-byte aligned and padded
+
+    constexpr CADeltaRange() {}
+
+    constexpr explicit CADeltaRange(uint32_t offset, uint32_t size_bytes) :
+        offset(offset),
+        size_bytes(size_bytes)
+    {}
+};
+
+Serializer& operator<<(Serializer& buf, const CADeltaRange& m);
+Serializer& operator>>(Serializer& buf, CADeltaRange& m);
+
 }
 
 std::ostream& operator<<(std::ostream& strm, const epics_diode::Serializer& s);
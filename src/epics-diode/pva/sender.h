@@ -6,19 +6,28 @@
 #ifndef EPICS_DIODE_PVA_SENDER_H
 #define EPICS_DIODE_PVA_SENDER_H
 
+#include <atomic>
 #include <memory>
 #include <string>
 
 #include <epics-diode/config.h>
 
 namespace epics_diode {
+
+class TransmitQueue;
+
 namespace pva {
 
 class Sender {
 public:
     Sender(const epics_diode::Config& config, const std::string& send_addresses);
+    // Sends through a transmit queue shared with other senders, with a bandwidth 'weight' relative to them.
+    // The queue must be started (TransmitQueue::start()) once all the senders are created.
+    Sender(const epics_diode::Config& config, const std::string& send_addresses,
+           epics_diode::TransmitQueue& transmitter, double weight);
     ~Sender();
-    void run(double runtime);
+    // Runs until 'stop' (if set) is raised by the caller.
+    void run(double runtime, const std::atomic<bool>* stop = nullptr);
 
 private:
     struct Impl;
@@ -6,6 +6,7 @@
 #ifndef EPICS_DIODE_RECEIVER_H
 #define EPICS_DIODE_RECEIVER_H
 
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -16,10 +17,11 @@ namespace epics_diode {
 class Receiver {
 public:
     using Callback = std::function<void(uint32_t channel_index, uint16_t type, uint32_t count, void* value)>;
+    using LinkCallback = std::function<void(bool link_up)>;
 
     Receiver(const epics_diode::Config& config, int port, std::string listening_address);
     ~Receiver();
-    void run(double runtime, Callback callback);
+    void run(double runtime, Callback callback, LinkCallback link_callback = LinkCallback());
 
 private:
     struct Impl;
@@ -0,0 +1,34 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#ifndef EPICS_DIODE_RELAY_H
+#define EPICS_DIODE_RELAY_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <epics-diode/config.h>
+
+namespace epics_diode {
+
+// Forwards messages of a sender to the next hop of a diode chain, without decoding the values.
+// Messages are validated (header, configuration hash, sender and sequence) and sent on as they are,
+// or, if 'destination' is given, rewritten to its channel subset. Forwarding is paced at 'rate_limit_mbs'.
+class Relay {
+public:
+    Relay(const epics_diode::Config& config, int port, std::string listening_address,
+          const std::string& send_addresses, const std::string& destination, uint32_t rate_limit_mbs);
+    ~Relay();
+    void run(double runtime);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+}
+
+#endif
@@ -6,22 +6,41 @@
 #ifndef EPICS_DIODE_SENDER_H
 #define EPICS_DIODE_SENDER_H
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <epics-diode/config.h>
 
 namespace epics_diode {
 
+class TransmitQueue;
+
 class Sender {
 public:
     Sender(const epics_diode::Config& config, const std::string& send_addresses);
+    // Sends through a transmit queue shared with other senders, with a bandwidth 'weight' relative to them.
+    // The queue must be started (TransmitQueue::start()) once all the senders are created.
+    Sender(const epics_diode::Config& config, const std::string& send_addresses,
+           TransmitQueue& transmitter, double weight);
     ~Sender();
-    void run(double runtime);
+    // Runs until 'stop' (if set) is raised by the caller, a failing shard raises it.
+    void run(double runtime, std::atomic<bool>* stop = nullptr);
 
 private:
-    struct Impl;
-    std::unique_ptr<Impl> impl;
+    friend struct SenderBenchmark;      // send path benchmark (test/unitTests/bench_sender.cpp)
+    friend struct SenderTest;           // message assembly tests (test/unitTests/test_sender.cpp)
+
+    void create_shards();
+
+    struct Impl;        // sender shard: CA context, channel table and message assembly
+    struct Transport;   // paced transport shared by the shards
+
+    std::vector<uint32_t> shard_offsets;
+    std::vector<Config> shard_configs;
+    std::unique_ptr<Transport> transport;
+    std::unique_ptr<Impl> impl;         // single shard only, otherwise shards are created by run()
 };
 
 }
@@ -6,10 +6,16 @@
 #ifndef EPICS_DIODE_TRANSPORT_H
 #define EPICS_DIODE_TRANSPORT_H
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <osiSock.h>
@@ -46,6 +52,15 @@ public:
 
     void send(const uint8_t* buffer, std::size_t length);
 
+    // send() split in two steps, allows message to be updated just before transmission
+    std::chrono::microseconds wait_rate_limit();
+    void transmit(const uint8_t* buffer, std::size_t length);
+    void transmit(const uint8_t* buffer, std::size_t length, const std::vector<osiSockAddr>& addresses);
+
+    inline const std::vector<osiSockAddr>& addresses() const {
+        return send_addresses;
+    }
+
 private:
     Logger logger;
     
@@ -64,16 +79,151 @@ private:
 };
 
 
+// Single-producer single-consumer lock-free ring of buffer indices.
+class IndexRing {
+public:
+    explicit IndexRing(std::size_t capacity);
+
+    bool push(uint32_t index);      // producer only, false if full
+    bool pop(uint32_t& index);      // consumer only, false if empty
+
+private:
+    std::vector<uint32_t> slots;
+    const std::size_t mask;
+    std::atomic<std::size_t> head{0};   // next slot to pop, written by consumer
+    std::atomic<std::size_t> tail{0};   // next slot to push, written by producer
+};
+
+
+// Wake-up signal of a thread sleeping on an empty IndexRing.
+class Signal {
+public:
+    void notify();
+    // Returns when notified (or after the timeout), the notification is consumed.
+    void wait(std::chrono::milliseconds timeout);
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool notified = false;
+};
+
+
+// Rate-limited sending in a dedicated transmit thread.
+// Messages are assembled by producer threads in pools of packet buffers, one pool (lane) per producer.
+// Committed buffers are passed to the transmit thread through lock-free queues and returned to the pool once sent,
+// the lanes are served round-robin. While one buffer is being paced out, the next one can be assembled;
+// a producer blocks only when all the buffers of its lane are in flight.
+// Lanes are added in groups (e.g. one group per sender sharing the transport), the bandwidth is split among
+// the groups with pending packets by their weights (deficit round-robin), unused share is taken by the others.
+class TransmitQueue {
+public:
+    // Called in the transmit thread just before a packet marked by commit() is sent, with the time
+    // the packet spent waiting in the queue and in the rate-limiter.
+    using PrepareCallback = std::function<void(uint8_t* packet, std::size_t offset, std::chrono::microseconds delay)>;
+
+    // One lane per preset, every buffer of a lane starts with its preset bytes (e.g. a message header).
+    // Packets of a lane are sent to its 'lane_addresses' entry, if given, otherwise to the sender addresses;
+    // a lane without addresses is not sent at all.
+    TransmitQueue(UDPSender& sender, std::size_t buffer_count, std::size_t buffer_size,
+                  const std::vector<std::vector<uint8_t>>& presets, PrepareCallback prepare,
+                  const std::vector<std::vector<osiSockAddr>>& lane_addresses = {});
+    // Queue shared by several producer groups, lanes are added by add_lanes() and sending is started by start().
+    TransmitQueue(UDPSender& sender, std::size_t buffer_count, std::size_t buffer_size);
+    // Sends all the committed packets before returning.
+    ~TransmitQueue();
+
+    // Adds a group of lanes (see above) with a bandwidth 'weight', returns the index of its first lane.
+    std::size_t add_lanes(const std::vector<std::vector<uint8_t>>& presets, PrepareCallback prepare,
+                          const std::vector<std::vector<osiSockAddr>>& lane_addresses = {}, double weight = 1.0);
+    // Starts the transmit thread, no lanes can be added afterwards.
+    void start();
+
+    // Current assembly buffer of the lane, the same buffer is returned until committed.
+    std::vector<uint8_t>& buffer(std::size_t lane = 0);
+
+    // Queues first 'length' bytes of the current buffer of the lane for sending,
+    // 'prepare_offset' (if non-zero) is passed to the prepare callback.
+    void commit(std::size_t lane, std::size_t length, std::size_t prepare_offset = 0);
+
+private:
+    struct Lane;
+    struct Group;
+
+    void run();
+    Lane* next_ready_lane(Group& group);
+    void transmit(Lane& lane);
+
+    Logger logger;
+    UDPSender& sender;
+    const std::size_t buffer_count;
+    const std::size_t buffer_size;
+
+    using clock_type = std::chrono::steady_clock;
+
+    struct Packet {
+        std::vector<uint8_t> data;
+        std::size_t length = 0;
+        std::size_t prepare_offset = 0;
+        clock_type::time_point commit_time;
+    };
+
+    static constexpr uint32_t NO_BUFFER = UINT32_MAX;
+
+    struct Lane {
+        explicit Lane(std::size_t buffer_count) :
+            packets(buffer_count),
+            ready_ring(buffer_count),
+            free_ring(buffer_count)
+        {}
+
+        std::vector<Packet> packets;
+        std::vector<osiSockAddr> addresses;
+        PrepareCallback prepare;
+        IndexRing ready_ring;           // producer -> transmit thread
+        IndexRing free_ring;            // transmit thread -> producer
+        Signal free_signal;
+        uint32_t current = NO_BUFFER;   // buffer being assembled (producer only)
+        uint32_t next = NO_BUFFER;      // buffer taken from the ready ring, waiting for its turn (transmit thread only)
+    };
+
+    struct Group {
+        Group(std::size_t first_lane, std::size_t lane_count, double weight) :
+            first_lane(first_lane),
+            lane_count(lane_count),
+            weight(weight)
+        {}
+
+        std::size_t first_lane;
+        std::size_t lane_count;
+        double weight;
+        std::size_t quantum = 0;        // bytes added to the deficit per round
+        std::size_t deficit = 0;        // bytes the group may still send in this round
+        std::size_t next_lane = 0;      // round-robin position within the group
+    };
+
+    std::vector<std::unique_ptr<Lane>> lanes;
+    std::vector<Group> groups;
+    Signal ready_signal;
+
+    std::atomic<bool> stop{false};
+    std::thread thread;
+};
+
+
 class UDPReceiver {
 public:
-    explicit UDPReceiver(int port, std::string listening_address);
+    explicit UDPReceiver(int port, std::string listening_address, bool rx_timestamps = false);
     ~UDPReceiver();
 
-    ssize_t receive(const uint8_t* buffer, std::size_t length, osiSockAddr* fromAddress);
+    // rx_time, if not null, is set to kernel receive timestamp (if enabled and supported), or current time
+    ssize_t receive(const uint8_t* buffer, std::size_t length, osiSockAddr* fromAddress,
+                    std::chrono::system_clock::time_point* rx_time = nullptr);
 
 private:
     Logger logger;
     SOCKET socket;
+    bool rx_timestamps;
 };
 
 }
@@ -0,0 +1,124 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <limits>
+
+#include <epics-diode/histogram.h>
+
+namespace epics_diode {
+
+namespace {
+
+constexpr uint64_t SUB_BUCKET_COUNT = uint64_t(1) << Histogram::SUB_BUCKET_BITS;
+// values below 2 * SUB_BUCKET_COUNT are recorded exactly
+constexpr uint64_t LINEAR_LIMIT = 2 * SUB_BUCKET_COUNT;
+constexpr std::size_t BUCKET_COUNT =
+    LINEAR_LIMIT + (Histogram::MAX_VALUE_BITS - Histogram::SUB_BUCKET_BITS - 1) * SUB_BUCKET_COUNT;
+
+unsigned ilog2(uint64_t val)
+{
+    unsigned ret = 0;
+    while (val >>= 1) {
+        ret++;
+    }
+    return ret;
+}
+
+}
+
+Histogram::Histogram() :
+    buckets(BUCKET_COUNT)
+{
+}
+
+std::size_t Histogram::bucket_index(uint64_t value)
+{
+    if (value < LINEAR_LIMIT) {
+        return std::size_t(value);
+    }
+
+    auto exponent = ilog2(value);
+    auto shift = exponent - SUB_BUCKET_BITS;
+    auto index = LINEAR_LIMIT + (exponent - SUB_BUCKET_BITS - 1) * SUB_BUCKET_COUNT +
+                 ((value >> shift) - SUB_BUCKET_COUNT);
+    return std::min(std::size_t(index), BUCKET_COUNT - 1);
+}
+
+uint64_t Histogram::bucket_value(std::size_t index)
+{
+    if (index < LINEAR_LIMIT) {
+        return index;
+    }
+
+    // middle of the bucket range
+    auto range = (index - LINEAR_LIMIT) / SUB_BUCKET_COUNT;
+    auto sub = (index - LINEAR_LIMIT) % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+    auto shift = range + 1;
+    return (sub << shift) + ((uint64_t(1) << shift) >> 1);
+}
+
+void Histogram::record(int64_t value)
+{
+    // negative values (e.g. due to clock offsets) are counted as 0
+    value = std::max(value, int64_t(0));
+
+    buckets[bucket_index(uint64_t(value))]++;
+
+    if (total_count == 0) {
+        min_value = max_value = value;
+    } else {
+        min_value = std::min(min_value, value);
+        max_value = std::max(max_value, value);
+    }
+    total_count++;
+    sum += value;
+}
+
+void Histogram::reset()
+{
+    std::fill(buckets.begin(), buckets.end(), 0);
+    total_count = 0;
+    min_value = max_value = 0;
+    sum = 0;
+}
+
+double Histogram::mean() const
+{
+    return total_count ? (sum / total_count) : 0.0;
+}
+
+int64_t Histogram::percentile(double p) const
+{
+    if (total_count == 0) {
+        return 0;
+    }
+
+    auto target = uint64_t(std::max(1.0, (p / 100.0) * total_count + 0.5));
+    uint64_t accumulated = 0;
+    for (std::size_t i = 0; i < buckets.size(); i++) {
+        accumulated += buckets[i];
+        if (accumulated >= target) {
+            // bucket value is an approximation, keep it within recorded bounds
+            return std::min(std::max(int64_t(bucket_value(i)), min_value), max_value);
+        }
+    }
+    return max_value;
+}
+
+std::string Histogram::summary(double scale) const
+{
+    std::array<char, 160> text{};
+    snprintf(text.begin(), text.size(),
+             "n=%llu, min=%.3f, p50=%.3f, p90=%.3f, p99=%.3f, p99.9=%.3f, max=%.3f, mean=%.3f",
+             (unsigned long long)total_count,
+             min() / scale, percentile(50) / scale, percentile(90) / scale,
+             percentile(99) / scale, percentile(99.9) / scale, max() / scale, mean() / scale);
+    return std::string(text.begin());
+}
+
+}
@@ -19,6 +19,7 @@ Serializer& operator<<(Serializer& buf, const Header& h) {
     if (buf.ensure(Header::size)) {
         buf << h.magic;
         buf << h.version;
+        buf << h.stream_id;
         buf += sizeof(h.reserved);
         buf << h.startup_time;
         buf << h.config_hash;
@@ -30,6 +31,7 @@ Serializer& operator>>(Serializer& buf, Header& h) {
     if (buf.ensure(Header::size)) {
         buf >> h.magic;
         buf >> h.version;
+        buf >> h.stream_id;
         buf += sizeof(h.reserved);
         buf >> h.startup_time;
         buf >> h.config_hash;
@@ -55,6 +57,64 @@ Serializer& operator>>(Serializer& buf, SubmessageHeader& h) {
     return buf;
 }
 
+Serializer& operator<<(Serializer& buf, const BeaconMessage& m) {
+    if (buf.ensure(BeaconMessage::size)) {
+        buf << m.seq_no;
+        buf << m.reserved;
+        buf << m.queue_depth;
+        buf << m.startup_time;
+    }
+    return buf;
+}
+
+Serializer& operator>>(Serializer& buf, BeaconMessage& m) {
+    if (buf.ensure(BeaconMessage::size)) {
+        buf >> m.seq_no;
+        buf += sizeof(m.reserved);
+        buf >> m.queue_depth;
+        buf >> m.startup_time;
+    }
+    return buf;
+}
+
+Serializer& operator<<(Serializer& buf, const TimestampMessage& m) {
+    if (buf.ensure(TimestampMessage::size)) {
+        buf << m.channel_count;
+        buf << m.reserved;
+        buf << m.send_time;
+        buf << m.pacing_delay;
+        buf << m.reserved2;
+    }
+    return buf;
+}
+
+Serializer& operator>>(Serializer& buf, TimestampMessage& m) {
+    if (buf.ensure(TimestampMessage::size)) {
+        buf >> m.channel_count;
+        buf += sizeof(m.reserved);
+        buf >> m.send_time;
+        buf >> m.pacing_delay;
+        buf += sizeof(m.reserved2);
+    }
+    return buf;
+}
+
+Serializer& operator<<(Serializer& buf, const ChannelAge& m) {
+    if (buf.ensure(ChannelAge::size)) {
+        buf << m.channel_id;
+        buf << m.queue_age;
+    }
+    return buf;
+}
+
+Serializer& operator>>(Serializer& buf, ChannelAge& m) {
+    if (buf.ensure(ChannelAge::size)) {
+        buf >> m.channel_id;
+        buf >> m.queue_age;
+    }
+    return buf;
+}
+
 Serializer& operator<<(Serializer& buf, const CADataMessage& m) {
     if (buf.ensure(CADataMessage::size)) {
         buf << m.seq_no;
@@ -113,6 +173,84 @@ Serializer& operator>>(Serializer& buf, CAFragDataMessage& m) {
     return buf;
 }
 
+Serializer& operator<<(Serializer& buf, const CARefreshMessage& m) {
+    if (buf.ensure(CARefreshMessage::size)) {
+        buf << m.channel_count;
+        buf << m.reserved;
+    }
+    return buf;
+}
+
+Serializer& operator>>(Serializer& buf, CARefreshMessage& m) {
+    if (buf.ensure(CARefreshMessage::size)) {
+        buf >> m.channel_count;
+        buf >> m.reserved;
+    }
+    return buf;
+}
+
+Serializer& operator<<(Serializer& buf, const CAChannelRefresh& m) {
+    if (buf.ensure(CAChannelRefresh::size)) {
+        buf << m.id;
+        buf << m.generation;
+        buf << m.reserved;
+        buf << m.value_hash;
+    }
+    return buf;
+}
+
+Serializer& operator>>(Serializer& buf, CAChannelRefresh& m) {
+    if (buf.ensure(CAChannelRefresh::size)) {
+        buf >> m.id;
+        buf >> m.generation;
+        buf >> m.reserved;
+        buf >> m.value_hash;
+    }
+    return buf;
+}
+
+Serializer& operator<<(Serializer& buf, const CADeltaDataMessage& m) {
+    if (buf.ensure(CADeltaDataMessage::size)) {
+        buf << m.seq_no;
+        buf << m.base_generation;
+        buf << m.channel_id;
+        buf << m.count;
+        buf << m.type;
+        buf << m.range_count;
+        buf << m.reserved;
+    }
+    return buf;
+}
+
+Serializer& operator>>(Serializer& buf, CADeltaDataMessage& m) {
+    if (buf.ensure(CADeltaDataMessage::size)) {
+        buf >> m.seq_no;
+        buf >> m.base_generation;
+        buf >> m.channel_id;
+        buf >> m.count;
+        buf >> m.type;
+        buf >> m.range_count;
+        buf >> m.reserved;
+    }
+    return buf;
+}
+
+Serializer& operator<<(Serializer& buf, const CADeltaRange& m) {
+    if (buf.ensure(CADeltaRange::size)) {
+        buf << m.offset;
+        buf << m.size_bytes;
+    }
+    return buf;
+}
+
+Serializer& operator>>(Serializer& buf, CADeltaRange& m) {
+    if (buf.ensure(CADeltaRange::size)) {
+        buf >> m.offset;
+        buf >> m.size_bytes;
+    }
+    return buf;
+}
+
 
 }
 
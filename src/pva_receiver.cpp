@@ -442,7 +442,7 @@ ssize_t Receiver::Impl::receive_updates(const Callback& callback) {
             break;
         } else {
             // adjust submessage
-            if (s.try_position(payload_pos + subheader.bytes_to_next_header)) {
+            if (!s.try_position(payload_pos + subheader.bytes_to_next_header)) {
                 // invalid submessage size, dropping packet
                 logger.log(LogLevel::Warning, "Submessage 'bytes_to_next_header' out of bounds, received from '%s'.",
                             to_string(fromAddress).c_str());
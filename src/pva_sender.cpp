@@ -4,11 +4,13 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <deque>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -171,6 +173,7 @@ struct Channel
 
 struct Sender::Impl {
     Impl(const epics_diode::Config& config, const std::string& send_addresses);
+    Impl(const epics_diode::Config& config, const std::string& send_addresses, TransmitQueue& shared_transmitter, double weight);
     ~Impl();
 
     Impl(const Impl&) = delete;
@@ -179,16 +182,17 @@ struct Sender::Impl {
     Impl& operator=(const Impl&) = delete;
     Impl& operator=(Impl&& other) = delete;
 
-    void run(double runtime);
+    void run(double runtime, const std::atomic<bool>* stop);
 
 private:
     Logger logger;
     
-    static constexpr double MIN_UPDATE_PERIOD = 0.025;
     static constexpr double MIN_POLLED_FIELDS_UPDATE_PERIOD = 3.0;
     static constexpr double MIN_HB_PERIOD = 0.1;
 
-    UDPSender initialize_sender(const std::string& send_address_list, const Config& config);
+    std::vector<osiSockAddr> initialize_addresses(const std::string& send_address_list, const Config& config);
+    std::vector<std::vector<Serializer::value_type>> preset_header(const Config& config) const;
+    void initialize(const Config& config);
     std::vector<Channel> create_channels(const Config& config);
     
     void send_typedef_updates();
@@ -218,8 +222,12 @@ private:
     uint64_t iteration = 0;
     const uint64_t hb_iterations;
 
-    std::vector<Serializer::value_type> send_buffer;  
-    UDPSender sender;
+    const std::vector<osiSockAddr> addresses;
+    const std::unique_ptr<UDPSender> sender;                // null if shared
+    const std::unique_ptr<TransmitQueue> own_transmitter;   // null if shared
+    TransmitQueue& transmitter;     // rate-limited sending, decoupled from PVA event processing
+    const std::size_t lane;
+    std::size_t pending_typedef_size = 0;   // last typedef submessage left in the lane buffer, sent with the next data submessage
 
     uint16_t seq_no = 0;
 
@@ -236,11 +244,33 @@ private:
 
 Sender::Impl::Impl(const epics_diode::Config& config, const std::string& send_addresses) :
     logger("pva.sender"),
-    update_period(std::max(config.min_update_period, MIN_UPDATE_PERIOD)),
+    update_period(config.effective_update_period()),
     heartbeat_period(std::max(config.heartbeat_period, MIN_HB_PERIOD)),
     hb_iterations(std::max(uint64_t(1), uint64_t(std::round(heartbeat_period / update_period)))),
-    send_buffer(MAX_MESSAGE_SIZE),
-    sender(initialize_sender(send_addresses, config))
+    addresses(initialize_addresses(send_addresses, config)),
+    sender(new UDPSender(addresses, config.rate_limit_mbs)),
+    own_transmitter(new TransmitQueue(*sender, config.transmit_buffers, MAX_MESSAGE_SIZE)),
+    transmitter(*own_transmitter),
+    lane(transmitter.add_lanes(preset_header(config), TransmitQueue::PrepareCallback()))
+{
+    transmitter.start();
+    initialize(config);
+}
+
+Sender::Impl::Impl(const epics_diode::Config& config, const std::string& send_addresses,
+                   TransmitQueue& shared_transmitter, double weight) :
+    logger("pva.sender"),
+    update_period(config.effective_update_period()),
+    heartbeat_period(std::max(config.heartbeat_period, MIN_HB_PERIOD)),
+    hb_iterations(std::max(uint64_t(1), uint64_t(std::round(heartbeat_period / update_period)))),
+    addresses(initialize_addresses(send_addresses, config)),
+    transmitter(shared_transmitter),
+    lane(transmitter.add_lanes(preset_header(config), TransmitQueue::PrepareCallback(), { addresses }, weight))
+{
+    initialize(config);
+}
+
+void Sender::Impl::initialize(const Config& config)
 {
     logger.log(LogLevel::Config, "Update period %.3fs, heartbeat period %.1fs.",
                 update_period, heartbeat_period);
@@ -267,7 +297,7 @@ Sender::Impl::~Impl() {
     context.close();
 }
 
-void Sender::Impl::run(double runtime) {
+void Sender::Impl::run(double runtime, const std::atomic<bool>* stop) {
     // Process PVA events forever, or specified amount of time.
     auto iterations = uint64_t(std::round(runtime / update_period));
     while (1)
@@ -344,14 +374,15 @@ void Sender::Impl::run(double runtime) {
         if (runtime > 0 && iteration >= iterations) {
             break;
         }
+        if (stop && stop->load()) {
+            break;
+        }
 
     }
 }
 
-UDPSender Sender::Impl::initialize_sender(const std::string& send_address_list, const Config& config)
+std::vector<osiSockAddr> Sender::Impl::initialize_addresses(const std::string& send_address_list, const Config& config)
 {
-    assert(send_buffer.size() % SubmessageHeader::alignment == 0);
-
     auto addresses = parse_socket_address_list(send_address_list, EPICS_PVADIODE_DEFAULT_PORT);
 
     logger.log(LogLevel::Trace, "Initializing transport.");
@@ -366,14 +397,21 @@ UDPSender Sender::Impl::initialize_sender(const std::string& send_address_list,
     logger.log(LogLevel::Info, "Initializing transport, send list: [%s].", parsed_list.c_str());
     logger.log(LogLevel::Config, "Send rate-limit set to %uMB/s.", config.rate_limit_mbs);
 
+    return addresses;
+}
+
+std::vector<std::vector<Serializer::value_type>> Sender::Impl::preset_header(const Config& config) const
+{
+    static_assert(MAX_MESSAGE_SIZE % SubmessageHeader::alignment == 0, "unaligned message size");
+
     uint64_t startup_time = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::system_clock::now().time_since_epoch()).count();
 
-    // Insert header at start.
-    Serializer s(send_buffer);
+    // Inserted at start of every send buffer.
+    std::vector<Serializer::value_type> header(Header::size);
+    Serializer s(header);
     s << Header(startup_time, config.hash);
-
-    return UDPSender(std::move(addresses), config.rate_limit_mbs);
+    return { header };
 }
 
 void Sender::Impl::send_fragmented_update(Channel* ch)
@@ -448,12 +486,13 @@ void Sender::Impl::send_typedef_updates()
     uint16_t id = TypeCache_::buildinCacheSize;
     while (size_t(id) < typeCache.size()) {
 
-        Serializer s(send_buffer);
+        Serializer s(transmitter.buffer(lane));
         s += Header::size; // skip preset header
     
         // we must always fit headers in the buffer
         s.ensure(SubmessageHeader::size + PVATypeDefMessage::size);
 
+        auto subheader_pos = s.position();
         s << SubmessageHeader(
                 SubmessageType::PVA_TYPEDEF_MESSAGE,
                 SubmessageFlag::LittleEndian,
@@ -481,7 +520,18 @@ void Sender::Impl::send_typedef_updates()
 
         logger.log(LogLevel::Debug, "Sending %u typedef update(s).", update_count);
 
-        sender.send(s.data(), bytes_to_send);
+        // the last typedef submessage is sent together with the data submessage that follows
+        if (size_t(id) == typeCache.size()) {
+            s.position(subheader_pos);
+            s << SubmessageHeader(
+                    SubmessageType::PVA_TYPEDEF_MESSAGE,
+                    SubmessageFlag::LittleEndian,
+                    uint16_t(bytes_to_send - (subheader_pos - s.data()) - SubmessageHeader::size));
+            pending_typedef_size = bytes_to_send;
+            break;
+        }
+
+        transmitter.commit(lane, bytes_to_send);
 
     }
 }
@@ -490,8 +540,10 @@ void Sender::Impl::send_updates()
 {
     while (has_updates()) {
 
-        Serializer s(send_buffer);
-        s += Header::size; // skip preset header
+        Serializer s(transmitter.buffer(lane));
+        // skip preset header (and pending typedefs)
+        s += pending_typedef_size ? pending_typedef_size : std::size_t(Header::size);
+        pending_typedef_size = 0;
     
         // we must always fit headers in the buffer
         s.ensure(SubmessageHeader::size + PVADataMessage::size);
@@ -536,12 +588,18 @@ void Sender::Impl::send_updates()
 
         logger.log(LogLevel::Debug, "Sending %u update(s).", update_count);
 
-        sender.send(s.data(), bytes_to_send);
+        transmitter.commit(lane, bytes_to_send);
 
         if (process_fragmented) {
             send_fragmented_updates();
         }
     }
+
+    // no data submessage to go with
+    if (pending_typedef_size) {
+        transmitter.commit(lane, pending_typedef_size);
+        pending_typedef_size = 0;
+    }
 }
 
 
@@ -619,10 +677,15 @@ Sender::Sender(const epics_diode::Config& config, const std::string& send_addres
     impl(new Impl(config, send_addresses)) {
 }
 
+Sender::Sender(const epics_diode::Config& config, const std::string& send_addresses,
+               TransmitQueue& transmitter, double weight) :
+    impl(new Impl(config, send_addresses, transmitter, weight)) {
+}
+
 Sender::~Sender() = default;
 
-void Sender::run(double runtime) {
-    impl->run(runtime);
+void Sender::run(double runtime, const std::atomic<bool>* stop) {
+    impl->run(runtime, stop);
 }
 
 }
@@ -6,6 +6,8 @@
 #include <algorithm>
 #include <cmath>
 #include <chrono>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <string>
@@ -14,17 +16,20 @@
 #include <cadef.h>
 
 #include <epics-diode/config.h>
+#include <epics-diode/encoding.h>
+#include <epics-diode/histogram.h>
 #include <epics-diode/logger.h>
 #include <epics-diode/protocol.h>
 #include <epics-diode/receiver.h>
 #include <epics-diode/transport.h>
+#include <epics-diode/utils.h>
 #include <epics-diode/version.h>
 
 namespace epics_diode {
 
 struct Receiver::Impl {
     Impl(const epics_diode::Config& config, int port, std::string listening_address);
-    void run(double runtime, Callback callback);
+    void run(double runtime, Callback callback, LinkCallback link_callback);
 
 private:
     Logger logger;
@@ -43,30 +48,91 @@ private:
         std::string name;
         bool disconnected = false;  // we want disconnected event to be sent after start (if no updated within heartbeat period)
         std::chrono::time_point<clock_type> last_update_time{};
+        bool generation_valid = false;  // value (as passed to callback) is known
+        uint16_t generation = 0;        // seq_no of the message that carried the value
+        uint64_t value_hash = 0;
+        ValueEncoding encoding;
+        bool array_delta = false;       // partial (delta) updates are applied to the last value
+        std::vector<uint8_t> value;
+        bool update_seq_valid = false;
+        uint16_t update_seq_no = 0;     // seq_no of the last delivered update, older fragmented values are dropped
+    };
+
+    // Reassembly of a fragmented value, fragments of several values may arrive interleaved.
+    struct Reassembly {
+        bool active = false;
+        uint32_t channel_id = 0;
+        uint16_t seq_no = 0;
+        uint16_t type = 0;
+        uint32_t count = 0;
+        std::vector<Serializer::value_type> buffer;
+        std::vector<bool> received;     // bitmap of received fragments
+        std::size_t remaining = 0;      // number of fragments not yet received
+        std::chrono::time_point<clock_type> last_fragment_time{};
     };
 
     static constexpr std::size_t MAX_CA_DATA_SIZE = 16 * 1024 * 1024;   
+    static constexpr double LINK_TIMEOUT_BEACON_PERIODS = 5.0;
+    static constexpr std::size_t MAX_REASSEMBLIES = 16;
+    static constexpr double REASSEMBLY_TIMEOUT = 1.0;     // since the last fragment received
 
     UDPReceiver initialize_receiver(int port, std::string listening_address, const Config& config);
     std::vector<Channel> create_channels(const Config& config);
 
     bool validate_order(uint16_t seq_no);
-    bool validate_order(uint16_t seq_no, uint16_t fragment_seq_no);
     bool validate_sender(uint64_t startup_time);
     ssize_t receive_updates(const Callback& callback);
     void check_no_updates(Callback callback);
+    void check_link(const Callback& callback, const LinkCallback& link_callback);
+    void notify_disconnected(Channel& channel, const Callback& callback);
+    void update_generation(Channel& channel, uint16_t generation, const void* value, std::size_t size);
+    void refresh_channels(Serializer& s);
+    void apply_delta(Serializer& s, const CADeltaDataMessage& delta_msg, const Callback& callback);
+    void receive_fragment(Serializer& s, const CAFragDataMessage& frag_msg, const Callback& callback);
+    Reassembly* find_reassembly(const CAFragDataMessage& frag_msg, std::size_t total_size, std::size_t fragment_count);
+    void expire_reassemblies();
+    bool is_stale(const Channel& channel, uint16_t seq_no) const;
+    void update_seq_no(Channel& channel, uint16_t seq_no);
+    void* decode_value(const Channel& channel, uint16_t& type, uint32_t count, void* data);
+    void record_latency(Serializer& s, const TimestampMessage& timestamp_msg);
+    void report_latency();
 
     std::size_t config_hash;
     double heartbeat_period;
+    double link_timeout;    // 0 means link loss is not detected
+    bool lightweight_refresh;
+
+    bool link_up = false;
+    bool packet_received = false;
+    std::chrono::time_point<clock_type> last_packet_time{};
+
+    // latency telemetry
+    struct ChannelStamp {
+        uint32_t id;
+        int64_t stamp;  // EPICS timestamp in nanoseconds since the UNIX epoch, 0 if not available
+    };
+
+    bool latency_telemetry;
+    std::chrono::system_clock::time_point rx_time{};
+    std::vector<ChannelStamp> message_stamps;       // channel updates of the current message
+    Histogram source_latency;                       // EPICS timestamp -> CA event on sender
+    Histogram queueing_latency;                     // CA event -> send (incl. rate-limiter pacing)
+    Histogram wire_latency;                         // send -> kernel receive
+    std::chrono::time_point<clock_type> last_latency_report_time;
     std::vector<Serializer::value_type> receive_buffer;
-    std::vector<Serializer::value_type> fragment_buffer;
-    Serializer fragment_serializer;
+    std::vector<Reassembly> reassemblies;
+    std::vector<uint8_t> decode_buffer;
 
     UDPReceiver receiver;
 
-    uint16_t last_seq_no = (uint16_t)-1;
-    uint16_t active_fragment_seq_no = (uint16_t)-1;
-    uint16_t last_fragment_seq_no = (uint16_t)-1;
+    // sequence stream (sender shard) state
+    struct Stream {
+        uint16_t last_seq_no = (uint16_t)-1;
+        uint16_t last_beacon_seq_no = (uint16_t)-1;
+    };
+
+    std::vector<Stream> streams;        // indexed by stream_id, grown on demand
+    Stream* stream = nullptr;           // stream of the current message
     uint64_t last_startup_time = 0;
 
     std::vector<Channel> channels;
@@ -77,9 +143,11 @@ Receiver::Impl::Impl(const Config& config, int port, std::string listening_addre
     last_heartbeat_time(clock_type::now()),
     config_hash(config.hash),
     heartbeat_period(config.heartbeat_period),
+    link_timeout(LINK_TIMEOUT_BEACON_PERIODS * config.effective_beacon_period()),
+    lightweight_refresh(config.full_refresh_period > 0),
+    latency_telemetry(config.latency_telemetry),
+    last_latency_report_time(clock_type::now()),
     receive_buffer(MAX_MESSAGE_SIZE),
-    fragment_buffer(MAX_CA_DATA_SIZE),
-    fragment_serializer(fragment_buffer.data(), 0),
     receiver(initialize_receiver(port, listening_address, config)),
     channels(create_channels(config))
 {
@@ -94,23 +162,317 @@ void Receiver::Impl::check_no_updates(Callback callback) {
         for (auto &channel : channels) {
             if (!channel.disconnected &&
                 std::chrono::duration_cast<secs>(current_update_time - channel.last_update_time).count() >= invalidate_period) {
+                notify_disconnected(channel, callback);
+            }
+        }
+        last_heartbeat_time = current_update_time;
+    }
+}
 
-                // mark as disconnected and call callback
-                channel.disconnected = true;
+void Receiver::Impl::notify_disconnected(Channel& channel, const Callback& callback) {
+    // mark as disconnected and call callback
+    channel.disconnected = true;
+    // refreshes cannot revalidate the value, a full value is needed
+    channel.generation_valid = false;
+
+    // guarded callback call
+    try {
+        callback(channel.id, 0, (uint32_t)-1, 0);
+    } catch (std::exception& ex) {
+        logger.log(LogLevel::Error, "Exception escaped out of callback: %s", ex.what());
+    }
+}
 
-                // guarded callback call
-                try {
-                    callback(channel.id, 0, (uint32_t)-1, 0);
-                } catch (std::exception& ex) {
-                    logger.log(LogLevel::Error, "Exception escaped out of callback: %s", ex.what());
-                }
+void Receiver::Impl::update_generation(Channel& channel, uint16_t generation, const void* value, std::size_t size) {
+    if (lightweight_refresh || channel.array_delta) {
+        channel.generation_valid = true;
+        channel.generation = generation;
+    }
+    if (lightweight_refresh) {
+        channel.value_hash = epics_diode::value_hash(value, uint32_t(size));
+    }
+    if (channel.array_delta && value != channel.value.data()) {
+        auto bytes = static_cast<const uint8_t*>(value);
+        channel.value.assign(bytes, bytes + size);
+    }
+}
+
+void Receiver::Impl::apply_delta(Serializer& s, const CADeltaDataMessage& delta_msg, const Callback& callback) {
+    if (delta_msg.channel_id >= channels.size()) {
+        return;
+    }
+
+    Channel& channel = channels[delta_msg.channel_id];
+    auto value_size = (std::size_t)dbr_size_n(delta_msg.type & ~ENCODED_TYPE_FLAG, delta_msg.count);  // parasoft-suppress HICPP-1_2_1-i "Avoid conditions that always evaluate to the same value" - dbr_size_n internal check
+
+    // delta applies only to the value it was computed against
+    if (!channel.array_delta || !channel.generation_valid ||
+        channel.generation != delta_msg.base_generation ||
+        channel.value.size() != value_size) {
+        logger.log(LogLevel::Debug, "Delta of channel '%s' does not match the last value, waiting for a full update.",
+                    channel.name.c_str());
+        channel.generation_valid = false;
+        return;
+    }
+
+    for (uint16_t i = 0; i < delta_msg.range_count; i++) {
+        CADeltaRange range;
+        if (!s.ensure(CADeltaRange::size)) {
+            channel.generation_valid = false;
+            return;
+        }
+        s >> range;
+
+        if ((std::size_t)range.offset + range.size_bytes > value_size || !s.ensure(range.size_bytes)) {
+            logger.log(LogLevel::Debug, "Delta range of channel '%s' out of bounds.", channel.name.c_str());
+            channel.generation_valid = false;
+            return;
+        }
+
+        memcpy(channel.value.data() + range.offset, s.position(), range.size_bytes);
+        s += range.size_bytes;
+        s.pos_align(SubmessageHeader::alignment, 0);
+    }
+
+    channel.disconnected = false;
+    channel.last_update_time = current_update_time;
+    update_seq_no(channel, delta_msg.seq_no);
+    update_generation(channel, delta_msg.seq_no, channel.value.data(), channel.value.size());
+
+    uint16_t type = delta_msg.type;
+    void* data = decode_value(channel, type, delta_msg.count, channel.value.data());
+
+    // guarded callback call
+    if (data) {
+        try {
+            callback(delta_msg.channel_id, type, delta_msg.count, data);
+        } catch (std::exception& ex) {
+            logger.log(LogLevel::Error, "Exception escaped out of callback: %s", ex.what());
+        }
+    }
+}
+
+bool Receiver::Impl::is_stale(const Channel& channel, uint16_t seq_no) const {
+    // unsigned wraps are handled correctly
+    return channel.update_seq_valid && int16_t(uint16_t(seq_no - channel.update_seq_no)) < 0;
+}
+
+void Receiver::Impl::update_seq_no(Channel& channel, uint16_t seq_no) {
+    channel.update_seq_valid = true;
+    channel.update_seq_no = seq_no;
+}
+
+Receiver::Impl::Reassembly* Receiver::Impl::find_reassembly(
+    const CAFragDataMessage& frag_msg, std::size_t total_size, std::size_t fragment_count) {
+
+    Reassembly* free_slot = nullptr;
+    Reassembly* oldest = nullptr;
+    for (auto& r : reassemblies) {
+        if (!r.active) {
+            free_slot = free_slot ? free_slot : &r;
+            continue;
+        }
+        if (r.channel_id == frag_msg.channel_id) {
+            if (r.seq_no == frag_msg.seq_no) {
+                return &r;
             }
+            // superseded by a newer value, only one transfer per channel is in progress
+            logger.log(LogLevel::Debug, "Incomplete fragmented value of '%s' superseded.", channels[r.channel_id].name.c_str());
+            r.active = false;
+            free_slot = &r;
+            continue;
         }
-        last_heartbeat_time = current_update_time;
+        if (!oldest || r.last_fragment_time < oldest->last_fragment_time) {
+            oldest = &r;
+        }
+    }
+
+    Reassembly* r = free_slot;
+    if (!r) {
+        if (reassemblies.size() < MAX_REASSEMBLIES) {
+            reassemblies.emplace_back();
+            r = &reassemblies.back();
+        } else {
+            logger.log(LogLevel::Debug, "Reassembly table full, dropping incomplete fragmented value of '%s'.",
+                        channels[oldest->channel_id].name.c_str());
+            r = oldest;
+        }
+    }
+
+    // buffer capacity is reused
+    r->active = true;
+    r->channel_id = frag_msg.channel_id;
+    r->seq_no = frag_msg.seq_no;
+    r->type = frag_msg.type;
+    r->count = frag_msg.count;
+    r->buffer.resize(total_size);
+    r->received.assign(fragment_count, false);
+    r->remaining = fragment_count;
+
+    logger.log(LogLevel::Debug, "Expecting to receive %zu total bytes of fragments for '%s'.",
+                total_size, channels[frag_msg.channel_id].name.c_str());
+    return r;
+}
+
+void Receiver::Impl::receive_fragment(Serializer& s, const CAFragDataMessage& frag_msg, const Callback& callback) {
+    if (frag_msg.channel_id >= channels.size()) {
+        return;
+    }
+
+    constexpr std::size_t max_fragment_size = CAFragDataMessage::max_fragment_size;
+    auto total_size = (std::size_t)dbr_size_n(frag_msg.type & ~ENCODED_TYPE_FLAG, frag_msg.count);  // parasoft-suppress HICPP-1_2_1-i "Avoid conditions that always evaluate to the same value" - dbr_size_n internal check
+    auto offset = std::size_t(frag_msg.fragment_seq_no) * max_fragment_size;
+
+    // all fragments but the last one are of max_fragment_size
+    if (total_size > MAX_CA_DATA_SIZE || offset >= total_size ||
+        frag_msg.fragment_size != std::min(max_fragment_size, total_size - offset) ||
+        !s.ensure(frag_msg.fragment_size)) {
+        logger.log(LogLevel::Debug, "Fragment out of bounds.");
+        return;
+    }
+
+    auto fragment_count = (total_size + max_fragment_size - 1) / max_fragment_size;
+    Reassembly* r = find_reassembly(frag_msg, total_size, fragment_count);
+    if (r->type != frag_msg.type || r->count != frag_msg.count) {
+        logger.log(LogLevel::Debug, "Fragment of an unexpected type or count.");
+        return;
+    }
+
+    r->last_fragment_time = current_update_time;
+    if (r->received[frag_msg.fragment_seq_no]) {
+        // duplicate
+        return;
+    }
+
+    memcpy(r->buffer.data() + offset, s.position(), frag_msg.fragment_size);
+    r->received[frag_msg.fragment_seq_no] = true;
+    r->remaining--;
+
+    logger.log(LogLevel::Trace, "Received fragment %u (%zu fragments remaining).",
+                frag_msg.fragment_seq_no, r->remaining);
+
+    if (r->remaining > 0) {
+        return;
+    }
+
+    // last fragment received
+    r->active = false;
+    Channel& channel = channels[r->channel_id];
+
+    // a newer update was already delivered (e.g. disconnect)
+    if (is_stale(channel, r->seq_no)) {
+        logger.log(LogLevel::Debug, "Fragmented value of '%s' is older than the last update, dropped.", channel.name.c_str());
+        return;
+    }
+
+    update_seq_no(channel, r->seq_no);
+    channel.disconnected = false;
+    channel.last_update_time = current_update_time;
+    update_generation(channel, r->seq_no, r->buffer.data(), r->buffer.size());
+
+    uint16_t type = r->type;
+    void* data = decode_value(channel, type, r->count, r->buffer.data());
+
+    // guarded callback call
+    if (data) {
+        try {
+            callback(r->channel_id, type, r->count, data);
+        } catch (std::exception& ex) {
+            logger.log(LogLevel::Error, "Exception escaped out of callback: %s", ex.what());
+        }
+    }
+}
+
+void Receiver::Impl::expire_reassemblies() {
+    using secs = std::chrono::duration<double>;
+
+    for (auto& r : reassemblies) {
+        if (r.active && secs(current_update_time - r.last_fragment_time).count() >= REASSEMBLY_TIMEOUT) {
+            logger.log(LogLevel::Debug, "Incomplete fragmented value of '%s' expired (%zu fragments missing).",
+                        channels[r.channel_id].name.c_str(), r.remaining);
+            r.active = false;
+        }
+    }
+}
+
+void Receiver::Impl::refresh_channels(Serializer& s) {
+    CARefreshMessage refresh_msg;
+    s >> refresh_msg;
+
+    for (uint16_t i = 0; i < refresh_msg.channel_count; i++) {
+        if (!s.ensure(CAChannelRefresh::size)) {
+            break;
+        }
+
+        CAChannelRefresh refresh;
+        s >> refresh;
+
+        if (refresh.id < channels.size()) {
+            Channel& channel = channels[refresh.id];
+            if (channel.generation_valid &&
+                channel.generation == refresh.generation &&
+                channel.value_hash == refresh.value_hash) {
+                channel.last_update_time = current_update_time;
+            } else {
+                // missed the last value, wait for full re-send
+                logger.log(LogLevel::Debug, "Stale value of channel '%s' not refreshed.", channel.name.c_str());
+            }
+        }
+    }
+}
+
+void* Receiver::Impl::decode_value(const Channel& channel, uint16_t& type, uint32_t count, void* data) {
+    if ((type & ENCODED_TYPE_FLAG) == 0) {
+        return data;
     }
+
+    uint16_t encoded_type = type & ~ENCODED_TYPE_FLAG;
+    if (!channel.encoding.decode(encoded_type, data, count, decode_buffer)) {
+        logger.log(LogLevel::Warning, "Unexpected encoding of channel '%s' value, check configuration.", channel.name.c_str());
+        return nullptr;
+    }
+
+    type = DBR_TIME_DOUBLE;
+    return decode_buffer.data();
 }
 
-void Receiver::Impl::run(double runtime, Callback callback) {
+void Receiver::Impl::check_link(const Callback& callback, const LinkCallback& link_callback) {
+    using secs = std::chrono::duration<double>;
+
+    bool link_changed = false;
+    if (packet_received) {
+        packet_received = false;
+        last_packet_time = current_update_time;
+
+        if (!link_up) {
+            link_up = link_changed = true;
+            logger.log(LogLevel::Info, "Link up.");
+        }
+    } else if (link_up && link_timeout > 0 &&
+               secs(current_update_time - last_packet_time).count() >= link_timeout) {
+        link_up = false;
+        link_changed = true;
+        logger.log(LogLevel::Warning, "Link down, no messages received in the last %.3fs.", link_timeout);
+
+        // invalidate all the channels at once, no need to wait for heartbeat check
+        for (auto &channel : channels) {
+            if (!channel.disconnected) {
+                notify_disconnected(channel, callback);
+            }
+        }
+    }
+
+    if (link_changed && link_callback) {
+        // guarded callback call
+        try {
+            link_callback(link_up);
+        } catch (std::exception& ex) {
+            logger.log(LogLevel::Error, "Exception escaped out of link callback: %s", ex.what());
+        }
+    }
+}
+
+void Receiver::Impl::run(double runtime, Callback callback, LinkCallback link_callback) {
     using secs = std::chrono::seconds;
 
     auto start = clock_type::now();
@@ -122,7 +484,13 @@ void Receiver::Impl::run(double runtime, Callback callback) {
 
         current_update_time = clock_type::now();
         
+        check_link(callback, link_callback);
         check_no_updates(callback);
+        expire_reassemblies();
+
+        if (latency_telemetry) {
+            report_latency();
+        }
 
         if (runtime > 0) {
             if (std::chrono::duration_cast<secs>(current_update_time - start).count() >= runtime) {
@@ -138,7 +506,7 @@ UDPReceiver Receiver::Impl::initialize_receiver(int port, std::string listening_
 
     assert(receive_buffer.size() % SubmessageHeader::alignment == 0);
 
-    return UDPReceiver(port, listening_address);
+    return UDPReceiver(port, listening_address, config.latency_telemetry);
 }
 
 std::vector<Receiver::Impl::Channel> Receiver::Impl::create_channels(const Config& config)
@@ -157,6 +525,8 @@ std::vector<Receiver::Impl::Channel> Receiver::Impl::create_channels(const Confi
                 current_channel_num++,
                 config_channel.channel_name
         });
+        channels.back().encoding = ValueEncoding(config_channel);
+        channels.back().array_delta = config_channel.array_delta && config_channel.keyframe_interval > 0;
 
         for (auto &field_name : config_channel.extra_fields) {
             channels.emplace_back(Channel{
@@ -176,11 +546,13 @@ std::vector<Receiver::Impl::Channel> Receiver::Impl::create_channels(const Confi
 }
 
 bool Receiver::Impl::validate_order(uint16_t seq_no) {
+    auto& last_seq_no = stream->last_seq_no;
     uint16_t diff = seq_no - last_seq_no;
 
     if (diff != 1 && last_seq_no != (uint16_t)-1) {
         // a bit high logging level, but we want admins to be aware of this
-        logger.log(LogLevel::Info, "Packet sequence anomaly detected, %u -> %u!", last_seq_no, seq_no);
+        logger.log(LogLevel::Info, "Packet sequence anomaly detected, %u -> %u (stream %zu)!",
+                    last_seq_no, seq_no, std::size_t(stream - streams.data()));
     }
 
     last_seq_no = seq_no;
@@ -191,47 +563,14 @@ bool Receiver::Impl::validate_order(uint16_t seq_no) {
     return (/*diff >= 0 && */ diff < tolerable_diff);
 }
 
-bool Receiver::Impl::validate_order(uint16_t seq_no, uint16_t fragment_seq_no) {
-
-    // first fragment
-    if (fragment_seq_no == 0) {
-        
-        // check seq_no, remember fragment seq_no
-        if (!validate_order(seq_no)) {
-            return false;
-        } else {
-            active_fragment_seq_no = seq_no;
-            last_fragment_seq_no = 0;
-            return true;
-        }
-
-    } else {
-
-        // check if the same as currently active fragment
-        if (active_fragment_seq_no != seq_no) {
-            active_fragment_seq_no = (uint16_t)-1;
-            return false;
-        }
-
-        // next fragment received check
-        if (++last_fragment_seq_no == fragment_seq_no) {
-            return true;
-        } else {
-            active_fragment_seq_no = (uint16_t)-1;
-            return false;
-        }
-
-    }
-}
-
 bool Receiver::Impl::validate_sender(uint64_t startup_time) {
     
     if (startup_time == last_startup_time) {
         return true;
     } else if (startup_time > last_startup_time) {
         last_startup_time = startup_time;
-        // reset seq_no
-        last_seq_no = (uint16_t)-1;
+        // reset seq_no of all the streams
+        streams.clear();
         return true;
     } else {
         // reject older senders
@@ -239,13 +578,67 @@ bool Receiver::Impl::validate_sender(uint64_t startup_time) {
     }
 }
 
+void Receiver::Impl::record_latency(Serializer& s, const TimestampMessage& timestamp_msg) {
+    using namespace std::chrono;
+
+    // one wire sample per message
+    auto rx_time_ns = duration_cast<nanoseconds>(rx_time.time_since_epoch()).count();
+    auto send_time_ns = int64_t(timestamp_msg.send_time);
+    wire_latency.record((rx_time_ns - send_time_ns) / 1000);
+
+    // channel ages are a subset of channel updates, in the same order
+    std::size_t stamp_index = 0;
+    for (uint16_t i = 0; i < timestamp_msg.channel_count; i++) {
+        if (!s.ensure(ChannelAge::size)) {
+            break;
+        }
+
+        ChannelAge channel_age;
+        s >> channel_age;
+
+        int64_t queueing_us = int64_t(channel_age.queue_age) + timestamp_msg.pacing_delay;
+        queueing_latency.record(queueing_us);
+
+        while (stamp_index < message_stamps.size() && message_stamps[stamp_index].id != channel_age.channel_id) {
+            stamp_index++;
+        }
+        if (stamp_index < message_stamps.size() && message_stamps[stamp_index].stamp) {
+            auto event_time_ns = send_time_ns - queueing_us * 1000;
+            source_latency.record((event_time_ns - message_stamps[stamp_index].stamp) / 1000);
+        }
+    }
+}
+
+void Receiver::Impl::report_latency() {
+    using secs = std::chrono::duration<double>;
+
+    if (secs(current_update_time - last_latency_report_time).count() < heartbeat_period) {
+        return;
+    }
+    last_latency_report_time = current_update_time;
+
+    if (wire_latency.count()) {
+        logger.log(LogLevel::Config, "Latency [ms] source->sender: %s", source_latency.summary(1000).c_str());
+        logger.log(LogLevel::Config, "Latency [ms] sender queueing: %s", queueing_latency.summary(1000).c_str());
+        logger.log(LogLevel::Config, "Latency [ms] wire/receive: %s", wire_latency.summary(1000).c_str());
+    }
+
+    source_latency.reset();
+    queueing_latency.reset();
+    wire_latency.reset();
+}
+
 ssize_t Receiver::Impl::receive_updates(const Callback& callback) {
     osiSockAddr fromAddress;
-    auto bytes_received = receiver.receive(receive_buffer.data(), receive_buffer.size(), &fromAddress);
+    auto bytes_received = receiver.receive(receive_buffer.data(), receive_buffer.size(), &fromAddress,
+                                           latency_telemetry ? &rx_time : nullptr);
     if (bytes_received <= 0) {
         return bytes_received;
     }
 
+    message_stamps.clear();
+    bool data_accepted = false;
+
     Serializer s(receive_buffer.data(), (std::size_t)bytes_received);
 
 #if 0
@@ -275,6 +668,16 @@ ssize_t Receiver::Impl::receive_updates(const Callback& callback) {
                         to_string(fromAddress).c_str());
             return bytes_received;
         }
+
+        // sequence numbers are validated per stream
+        if (header.stream_id >= streams.size()) {
+            streams.resize(header.stream_id + 1);
+        }
+        stream = &streams[header.stream_id];
+
+        packet_received = true;
+    } else {
+        return bytes_received;
     }
 
     while (s.ensure(SubmessageHeader::size)) {
@@ -290,18 +693,36 @@ ssize_t Receiver::Impl::receive_updates(const Callback& callback) {
 
         auto payload_pos = s.position();
 
-        if (subheader.id == SubmessageType::CA_DATA_MESSAGE) {
+        if (subheader.id == SubmessageType::BEACON_MESSAGE) {
+            if (s.ensure(BeaconMessage::size)) {
+                BeaconMessage beacon_msg;
+                s >> beacon_msg;
+
+                // detect lost messages also when there is no further traffic (report only once)
+                if (beacon_msg.seq_no != stream->last_seq_no && stream->last_seq_no != (uint16_t)-1 &&
+                    beacon_msg.seq_no != stream->last_beacon_seq_no) {
+                    logger.log(LogLevel::Info, "Beacon sequence anomaly detected, %u received, sender at %u (stream %zu)!",
+                                stream->last_seq_no, beacon_msg.seq_no, std::size_t(stream - streams.data()));
+                }
+                stream->last_beacon_seq_no = beacon_msg.seq_no;
+
+                logger.log(LogLevel::Trace, "Beacon received, sender queue depth %u.", beacon_msg.queue_depth);
+            }
+        }
+        else if (subheader.id == SubmessageType::CA_DATA_MESSAGE) {
             if (s.ensure(CADataMessage::size)) {
                 CADataMessage data_msg;
                 s >> data_msg;
 
                 if (validate_order(data_msg.seq_no)) {
+                    data_accepted = true;
                     for (uint16_t i = 0; i < data_msg.channel_count; i++) {
                         if (s.ensure(CAChannelData::size)) {
                             CAChannelData channel_data;
                             s >> channel_data;
 
                             bool disconnected = (channel_data.count == (uint16_t)-1);
+                            uint16_t dbr_type = channel_data.type & ~ENCODED_TYPE_FLAG;
 
                             if (channel_data.id < channels.size()) {
 
@@ -309,68 +730,84 @@ ssize_t Receiver::Impl::receive_updates(const Callback& callback) {
                                 Channel& channel = channels[channel_data.id];
                                 channel.disconnected = disconnected;
                                 channel.last_update_time = current_update_time;
+                                update_seq_no(channel, data_msg.seq_no);
+
+                                uint16_t type = channel_data.type;
+                                void* data = disconnected ? s.position() :
+                                    decode_value(channel, type, channel_data.count, s.position());
 
                                 // guarded callback call
-                                try {
-                                    uint32_t count = disconnected ? (uint32_t)-1 : channel_data.count;
-                                    callback(channel_data.id, channel_data.type, count, s.position());
-                                } catch (std::exception& ex) {
-                                    logger.log(LogLevel::Error, "Exception escaped out of callback: %s", ex.what());
+                                if (data) {
+                                    try {
+                                        uint32_t count = disconnected ? (uint32_t)-1 : channel_data.count;
+                                        callback(channel_data.id, type, count, data);
+                                    } catch (std::exception& ex) {
+                                        logger.log(LogLevel::Error, "Exception escaped out of callback: %s", ex.what());
+                                    }
                                 }
                             }
 
+                            if (latency_telemetry && !disconnected) {
+                                int64_t stamp = 0;
+                                if (dbr_type_is_TIME(dbr_type)) {
+                                    epicsTimeStamp ts;
+                                    memcpy(&ts, s.position() + offsetof(dbr_time_string, stamp), sizeof(ts));
+                                    if (ts.secPastEpoch || ts.nsec) {
+                                        stamp = (int64_t(ts.secPastEpoch) + POSIX_TIME_AT_EPICS_EPOCH) * 1000000000LL + ts.nsec;
+                                    }
+                                }
+                                message_stamps.push_back(ChannelStamp{channel_data.id, stamp});
+                            }
+
                             // skip data
+                            std::size_t value_size = 0;
                             if (!disconnected) {
-                                auto value_size = (std::size_t)dbr_size_n(channel_data.type, channel_data.count);  // parasoft-suppress HICPP-1_2_1-i "Avoid conditions that always evaluate to the same value" - dbr_size_n internal check
-                                s += value_size;
+                                value_size = (std::size_t)dbr_size_n(dbr_type, channel_data.count);  // parasoft-suppress HICPP-1_2_1-i "Avoid conditions that always evaluate to the same value" - dbr_size_n internal check
                             }
 
+                            if (channel_data.id < channels.size()) {
+                                update_generation(channels[channel_data.id], data_msg.seq_no, s.position(), value_size);
+                            }
+                            s += value_size;
+
                             s.pos_align(SubmessageHeader::alignment, 0);
                         }
                     }
                 }
             }
         }
+        else if (subheader.id == SubmessageType::CA_DELTA_DATA_MESSAGE) {
+            if (s.ensure(CADeltaDataMessage::size)) {
+                CADeltaDataMessage delta_msg;
+                s >> delta_msg;
+
+                if (validate_order(delta_msg.seq_no)) {
+                    apply_delta(s, delta_msg, callback);
+                }
+            }
+        }
+        else if (subheader.id == SubmessageType::CA_REFRESH_MESSAGE) {
+            // refreshes unchanged values, seq_no validated by the preceding data submessage
+            if (data_accepted && s.ensure(CARefreshMessage::size)) {
+                refresh_channels(s);
+            }
+        }
+        else if (subheader.id == SubmessageType::TIMESTAMP_MESSAGE) {
+            // telemetry of the preceding data submessage
+            if (latency_telemetry && data_accepted && s.ensure(TimestampMessage::size)) {
+                TimestampMessage timestamp_msg;
+                s >> timestamp_msg;
+                record_latency(s, timestamp_msg);
+            }
+        }
         else if (subheader.id == SubmessageType::CA_FRAG_DATA_MESSAGE) {
             if (s.ensure(CAFragDataMessage::size)) {
-                CAFragDataMessage data_msg;
-                s >> data_msg;
-
-                if (validate_order(data_msg.seq_no, data_msg.fragment_seq_no)) {
-
-                    // first fragment, initialize fragment buffer
-                    if (data_msg.fragment_seq_no == 0) {
-                        auto total_value_size = (std::size_t)dbr_size_n(data_msg.type, data_msg.count);  // parasoft-suppress HICPP-1_2_1-i "Avoid conditions that always evaluate to the same value" - dbr_size_n internal check
-                        fragment_buffer.resize(total_value_size);
-                        fragment_serializer = Serializer(fragment_buffer.data(), total_value_size);
-
-                        logger.log(LogLevel::Debug, "Expecting to receive %zu total bytes of fragments for '%s'.",
-                                    total_value_size, channels[data_msg.channel_id].name.c_str());
-                    }
-
-                    // copy fragment data
-                    if (fragment_serializer.remaining() >= data_msg.fragment_size) {
-                        fragment_serializer.write(s.position(), data_msg.fragment_size);
-
-                        logger.log(LogLevel::Trace, "Received fragment %u (%zu bytes remaining).",
-                                    data_msg.fragment_seq_no, fragment_serializer.remaining());
-
-                        // last fragment received
-                        if (fragment_serializer.remaining() == 0) {
-                            // guarded callback call
-                            try {
-                                callback(data_msg.channel_id, data_msg.type, data_msg.count, fragment_buffer.data());
-                            } catch (std::exception& ex) {
-                                logger.log(LogLevel::Error, "Exception escaped out of callback: %s", ex.what());
-                            }
-                        }
-
-                    } else {
-                        logger.log(LogLevel::Debug, "Total fragment size out of bounds.");
-                    }
+                CAFragDataMessage frag_msg;
+                s >> frag_msg;
 
-                    // not needed, will be handled below
-                    // s += fragment_size;
+                // only the first fragment takes part in seq_no ordering, the rest are interleaved with other messages
+                if (frag_msg.fragment_seq_no != 0 || validate_order(frag_msg.seq_no)) {
+                    receive_fragment(s, frag_msg, callback);
                 }
             }
         }
@@ -380,7 +817,7 @@ ssize_t Receiver::Impl::receive_updates(const Callback& callback) {
             break;
         } else {
             // adjust submessage
-            if (s.try_position(payload_pos + subheader.bytes_to_next_header)) {
+            if (!s.try_position(payload_pos + subheader.bytes_to_next_header)) {
                 // invalid submessage size, dropping packet
                 logger.log(LogLevel::Warning, "Submessage 'bytes_to_next_header' out of bounds, received from '%s'.",
                             to_string(fromAddress).c_str());
@@ -400,8 +837,8 @@ Receiver::Receiver(const epics_diode::Config& config, int port, std::string list
 
 Receiver::~Receiver() = default;
 
-void Receiver::run(double runtime, Callback callback) {
-    impl->run(runtime, std::move(callback));
+void Receiver::run(double runtime, Callback callback, LinkCallback link_callback) {
+    impl->run(runtime, std::move(callback), std::move(link_callback));
 }
 
 }
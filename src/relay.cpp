@@ -0,0 +1,327 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <epics-diode/config.h>
+#include <epics-diode/destination.h>
+#include <epics-diode/logger.h>
+#include <epics-diode/protocol.h>
+#include <epics-diode/relay.h>
+#include <epics-diode/transport.h>
+
+namespace epics_diode {
+
+namespace {
+
+constexpr std::size_t RELAY_LANE = 0;     // single producer, messages are forwarded in order of arrival
+
+}
+
+struct Relay::Impl {
+    Impl(const epics_diode::Config& config, int port, std::string listening_address,
+         const std::string& send_addresses, const std::string& destination, uint32_t rate_limit_mbs);
+    void run(double runtime);
+
+private:
+    Logger logger;
+
+    using clock_type = std::chrono::steady_clock;
+    std::chrono::time_point<clock_type> current_time{};
+    std::chrono::time_point<clock_type> last_report_time;
+
+    // sequence stream (sender shard) state
+    struct Stream {
+        uint16_t last_seq_no = (uint16_t)-1;
+    };
+
+    std::unique_ptr<Destination> create_destination(const Config& config, const std::string& name);
+    UDPReceiver initialize_receiver(int port, std::string listening_address);
+    UDPSender initialize_sender(const std::string& send_address_list, uint32_t rate_limit_mbs);
+
+    ssize_t relay_message();
+    bool validate_sender(uint64_t startup_time);
+    bool validate_order(Stream& stream, Serializer& s);
+    std::size_t rewrite(const Header& header, std::size_t length);
+    void report_statistics();
+
+    const std::size_t config_hash;
+    const double heartbeat_period;
+    const std::unique_ptr<Destination> destination;     // channel subset to be forwarded, null for all
+
+    UDPReceiver receiver;
+    UDPSender sender;
+    TransmitQueue transmitter;      // re-pacing, receiving continues while a message is paced out
+
+    std::vector<Serializer::value_type> receive_buffer;     // messages to be rewritten only, others are received in place
+    std::vector<Stream> streams;                            // indexed by stream_id, grown on demand
+    std::vector<DestinationStream> destination_streams;     // indexed by stream_id
+    uint64_t last_startup_time = 0;
+
+    std::size_t relayed_messages = 0;
+    std::size_t relayed_bytes = 0;
+    std::size_t dropped_messages = 0;
+};
+
+Relay::Impl::Impl(const Config& config, int port, std::string listening_address,
+                  const std::string& send_addresses, const std::string& destination_name, uint32_t rate_limit_mbs) :
+    logger("relay"),
+    last_report_time(clock_type::now()),
+    config_hash(config.hash),
+    heartbeat_period(config.heartbeat_period),
+    destination(create_destination(config, destination_name)),
+    receiver(initialize_receiver(port, listening_address)),
+    sender(initialize_sender(send_addresses, rate_limit_mbs)),
+    transmitter(sender, config.transmit_buffers, MAX_MESSAGE_SIZE,
+                { std::vector<Serializer::value_type>(Header::size) }, TransmitQueue::PrepareCallback())
+{
+    if (destination) {
+        receive_buffer.resize(MAX_MESSAGE_SIZE);
+    }
+}
+
+std::unique_ptr<Destination> Relay::Impl::create_destination(const Config& config, const std::string& name)
+{
+    std::unique_ptr<Destination> result;
+    if (name.empty()) {
+        logger.log(LogLevel::Info, "Relaying all %zu channels.", config.total_channel_count());
+        return result;
+    }
+
+    for (auto& config_destination : config.destinations) {
+        if (config_destination.name == name) {
+            result.reset(new Destination(config, config_destination));
+            logger.log(LogLevel::Info, "Relaying %u channel(s) of destination '%s'.",
+                        result->channel_count, name.c_str());
+            return result;
+        }
+    }
+    throw std::runtime_error("Destination '" + name + "' not configured.");
+}
+
+UDPReceiver Relay::Impl::initialize_receiver(int port, std::string listening_address)
+{
+    logger.log(LogLevel::Info, "Initializing transport, listening at '%s:%d'.", listening_address.c_str(), port);
+
+    return UDPReceiver(port, listening_address);
+}
+
+UDPSender Relay::Impl::initialize_sender(const std::string& send_address_list, uint32_t rate_limit_mbs)
+{
+    // destination address is used by default
+    auto addresses = parse_socket_address_list(send_address_list, EPICS_DIODE_DEFAULT_PORT);
+    if (addresses.empty() && destination) {
+        addresses = destination->addresses;
+    }
+    if (addresses.empty()) {
+        throw std::runtime_error("No send address specified.");
+    }
+
+    std::string parsed_list;
+    for (auto &address : addresses) {
+        if (!parsed_list.empty()) {
+            parsed_list += ", ";
+        }
+        parsed_list += to_string(address);
+    }
+
+    logger.log(LogLevel::Info, "Initializing transport, send list: [%s].", parsed_list.c_str());
+    logger.log(LogLevel::Config, "Send rate-limit set to %uMB/s.", rate_limit_mbs);
+
+    return UDPSender(std::move(addresses), rate_limit_mbs);
+}
+
+void Relay::Impl::run(double runtime) {
+    using secs = std::chrono::seconds;
+
+    auto start = clock_type::now();
+    while (1) {
+
+        // process packets
+        int max_packets_at_once = 100;
+        while (relay_message() > 0 && --max_packets_at_once);
+
+        current_time = clock_type::now();
+
+        report_statistics();
+
+        if (runtime > 0) {
+            if (std::chrono::duration_cast<secs>(current_time - start).count() >= runtime) {
+                break;
+            }
+        }
+    }
+}
+
+bool Relay::Impl::validate_sender(uint64_t startup_time) {
+
+    if (startup_time == last_startup_time) {
+        return true;
+    } else if (startup_time > last_startup_time) {
+        last_startup_time = startup_time;
+        // reset seq_no of all the streams, destination streams restart with the sender
+        streams.clear();
+        destination_streams.clear();
+        return true;
+    } else {
+        // reject older senders
+        return false;
+    }
+}
+
+bool Relay::Impl::validate_order(Stream& stream, Serializer& s) {
+    // Only the first submessage is checked: data, delta and the first fragment of a transfer carry a seq_no
+    // as their first field; fragment continuations and beacons are not sequenced.
+    SubmessageHeader subheader;
+    uint16_t seq_no = 0;
+    uint16_t fragment_seq_no = 0;
+    if (!s.ensure(SubmessageHeader::size + 2 * sizeof(uint16_t))) {
+        return true;
+    }
+    s >> subheader >> seq_no >> fragment_seq_no;
+
+    switch (subheader.id) {
+    case SubmessageType::CA_DATA_MESSAGE:
+    case SubmessageType::CA_DELTA_DATA_MESSAGE:
+        break;
+    case SubmessageType::CA_FRAG_DATA_MESSAGE:
+        if (fragment_seq_no == 0) {
+            break;
+        }
+        return true;
+    default:
+        return true;
+    }
+
+    auto& last_seq_no = stream.last_seq_no;
+    uint16_t diff = seq_no - last_seq_no;
+    if (last_seq_no != (uint16_t)-1) {
+        // duplicates and late (out-of-order) messages are dropped, gaps are reported by the receiver
+        constexpr uint16_t tolerable_diff = std::numeric_limits<uint16_t>::max() / 2;
+        if (diff == 0 || diff >= tolerable_diff) {
+            return false;
+        }
+    }
+
+    last_seq_no = seq_no;
+    return true;
+}
+
+std::size_t Relay::Impl::rewrite(const Header& header, std::size_t length)
+{
+    while (header.stream_id >= destination_streams.size()) {
+        destination_streams.emplace_back(*destination, RELAY_LANE);
+    }
+
+    auto& packet = transmitter.buffer(RELAY_LANE);
+    std::size_t prepare_offset = 0;
+    std::size_t packet_length = destination_streams[header.stream_id].rewrite(
+            receive_buffer.data(), length, packet.data(), prepare_offset);
+    if (packet_length) {
+        // destination stream keeps the identity of the sender
+        Serializer s(packet.data(), Header::size);
+        s << Header(header.startup_time, destination->hash, header.stream_id);
+    }
+    return packet_length;
+}
+
+ssize_t Relay::Impl::relay_message() {
+    // messages relayed as they are are received directly into the transmit buffer
+    auto* buffer = destination ? receive_buffer.data() : transmitter.buffer(RELAY_LANE).data();
+
+    osiSockAddr fromAddress;
+    auto bytes_received = receiver.receive(buffer, MAX_MESSAGE_SIZE, &fromAddress);
+    if (bytes_received <= 0) {
+        return bytes_received;
+    }
+
+    Serializer s(buffer, (std::size_t)bytes_received);
+
+    Header header;
+    if (!s.ensure(Header::size)) {
+        dropped_messages++;
+        return bytes_received;
+    }
+    s >> header;
+
+    if (!header.validate()) {
+        logger.log(LogLevel::Warning, "Invalid header received from '%s'.",
+                    to_string(fromAddress).c_str());
+        dropped_messages++;
+        return bytes_received;
+    }
+
+    if (header.config_hash != config_hash) {
+        logger.log(LogLevel::Warning, "Configuration mismatch to sender at '%s'.",
+                    to_string(fromAddress).c_str());
+        dropped_messages++;
+        return bytes_received;
+    }
+
+    if (!validate_sender(header.startup_time)) {
+        logger.log(LogLevel::Warning, "Multiple senders detected, rejecting older sender at '%s'.",
+                    to_string(fromAddress).c_str());
+        dropped_messages++;
+        return bytes_received;
+    }
+
+    if (header.stream_id >= streams.size()) {
+        streams.resize(header.stream_id + 1);
+    }
+    if (!validate_order(streams[header.stream_id], s)) {
+        dropped_messages++;
+        return bytes_received;
+    }
+
+    std::size_t length = (std::size_t)bytes_received;
+    if (destination) {
+        // nothing to be sent if the message carries no channel of the destination
+        length = rewrite(header, length);
+        if (!length) {
+            return bytes_received;
+        }
+    }
+
+    transmitter.commit(RELAY_LANE, length);
+    relayed_messages++;
+    relayed_bytes += length;
+
+    return bytes_received;
+}
+
+void Relay::Impl::report_statistics() {
+    using secs = std::chrono::duration<double>;
+
+    if (secs(current_time - last_report_time).count() < heartbeat_period) {
+        return;
+    }
+    last_report_time = current_time;
+
+    logger.log(LogLevel::Config, "Relayed %zu message(s) (%zu bytes), dropped %zu.",
+                relayed_messages, relayed_bytes, dropped_messages);
+
+    relayed_messages = relayed_bytes = dropped_messages = 0;
+}
+
+
+Relay::Relay(const Config& config, int port, std::string listening_address,
+             const std::string& send_addresses, const std::string& destination, uint32_t rate_limit_mbs) :
+    impl(new Impl(config, port, listening_address, send_addresses, destination, rate_limit_mbs)) {
+}
+
+Relay::~Relay() = default;
+
+void Relay::run(double runtime) {
+    impl->run(runtime);
+}
+
+}
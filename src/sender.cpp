@@ -4,18 +4,38 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
 #include <deque>
+#include <exception>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
 #include <cadef.h>
 #include <epicsString.h>
 
 #include <epics-diode/config.h>
+#include <epics-diode/destination.h>
+#include <epics-diode/encoding.h>
 #include <epics-diode/logger.h>
 #include <epics-diode/protocol.h>
 #include <epics-diode/sender.h>
@@ -25,37 +45,617 @@
 
 namespace epics_diode {
 
+// Deadband filter of numeric DBR_TIME_* values, compares against the last value sent in full.
+struct Deadband
+{
+    double abs = 0.0;
+    double rel = 0.0;
+    bool per_element = false;
+
+    Deadband() {}
+
+    explicit Deadband(const ConfigChannel& config_channel) :
+        abs(std::max(config_channel.deadband_abs, 0.0)),
+        rel(std::max(config_channel.deadband_rel, 0.0)),
+        per_element(config_channel.deadband_per_element)
+    {
+    }
+
+    inline bool enabled() const {
+        return abs > 0 || rel > 0;
+    }
+
+    inline void reset() {
+        reference_valid = false;
+        suppressed = false;
+    }
+
+    // Returns true if the value is to be sent (alarm transitions always are).
+    bool check(long type, const void* dbr, long count);
+
+    // The last checked value was sent in full (e.g. with a heartbeat), it becomes the reference.
+    inline void sent() {
+        if (suppressed) {
+            reference.swap(values);
+            status = suppressed_status;
+            severity = suppressed_severity;
+            reference_valid = true;
+            suppressed = false;
+        }
+    }
+
+private:
+    bool reference_valid = false;
+    dbr_short_t status = 0;
+    dbr_short_t severity = 0;
+    std::vector<double> reference;
+    std::vector<double> values;
+    bool suppressed = false;        // 'values' hold the last (suppressed) value
+    dbr_short_t suppressed_status = 0;
+    dbr_short_t suppressed_severity = 0;
+};
+
+// Array region of interest and downsampling, the DBR type is preserved.
+struct ArrayTransform
+{
+    uint32_t offset = 0;
+    uint32_t count = 0;
+    uint32_t stride = 1;
+    ArrayBinning binning = ArrayBinning::none;
+
+    ArrayTransform() {}
+
+    explicit ArrayTransform(const ConfigChannel& config_channel) :
+        offset(config_channel.array_offset),
+        count(config_channel.array_count),
+        stride(std::max(config_channel.array_stride, uint32_t(1))),
+        binning(config_channel.array_binning)
+    {
+    }
+
+    inline bool enabled() const {
+        return offset || count || stride > 1;
+    }
+
+    // Transforms 'dbr' of 'dbr_count' elements into 'value', returns the resulting number of elements.
+    long apply(long type, const void* dbr, long dbr_count, std::vector<uint8_t>& value) const;
+};
+
+// Timing wheel of deferred (rate-limited) channel updates, O(1) per schedule and per expiry.
+// One slot per update period (tick).
+class TimingWheel
+{
+public:
+    TimingWheel() : slots(1) {}
+
+    void resize(std::size_t slot_count) {
+        slots.resize(std::max(slot_count, std::size_t(1)));
+    }
+
+    inline uint64_t current_tick() const {
+        return tick;
+    }
+
+    // Assumes current_tick() < due_tick <= current_tick() + slot_count - 1.
+    inline void schedule(uint32_t index, uint64_t due_tick) {
+        slots[due_tick % slots.size()].push_back(index);
+    }
+
+    // Advances to the next tick, returns the due entries (to be cleared by the caller).
+    inline std::vector<uint32_t>& advance() {
+        return slots[++tick % slots.size()];
+    }
+
+private:
+    uint64_t tick = 0;
+    std::vector<std::vector<uint32_t>> slots;
+};
+
+// Growable FIFO ring buffer (power-of-two capacity), contiguous storage unlike std::deque.
+template<typename T>
+class RingBuffer
+{
+public:
+    inline bool empty() const {
+        return head == tail;
+    }
+
+    inline std::size_t size() const {
+        return tail - head;
+    }
+
+    inline const T& front() const {
+        return items[head & mask];
+    }
+
+    inline const T& operator[](std::size_t i) const {
+        return items[(head + i) & mask];
+    }
+
+    inline void push_back(const T& item) {
+        if (size() == items.size()) {
+            grow();
+        }
+        items[tail++ & mask] = item;
+    }
+
+    inline void pop_front() {
+        head++;
+    }
+
+private:
+    void grow() {
+        std::vector<T> grown(std::max(items.size() * 2, std::size_t(64)));
+        auto n = size();
+        for (std::size_t i = 0; i < n; i++) {
+            grown[i] = (*this)[i];
+        }
+        items.swap(grown);
+        mask = items.size() - 1;
+        head = 0;
+        tail = n;
+    }
+
+    std::vector<T> items;
+    std::size_t mask = 0;
+    std::size_t head = 0;   // monotonic, wrapped by mask
+    std::size_t tail = 0;
+};
+
+// Slab allocator of channel values: power-of-two size classes with free lists,
+// carved from large slabs (values of channels are adjacent in memory, no per-value heap allocation).
+// Values larger than the largest class are allocated from the heap.
+class ValueArena
+{
+public:
+    static constexpr std::size_t MIN_CLASS_SIZE = 16;      // also alignment of values
+    static constexpr std::size_t CLASS_COUNT = 9;          // 16B - 4kB
+    static constexpr std::size_t SLAB_SIZE = 256 * 1024;
+
+    ValueArena() = default;
+    ValueArena(const ValueArena&) = delete;
+    ValueArena& operator=(const ValueArena&) = delete;
+
+    // Allocates at least 'size' bytes, 'size' is updated to the actual capacity.
+    uint8_t* allocate(std::size_t& size) {
+        auto c = size_class(size);
+        if (c == CLASS_COUNT) {
+            return new uint8_t[size];
+        }
+
+        size = class_size(c);
+        auto& free_list = free_lists[c];
+        if (!free_list.empty()) {
+            auto* data = free_list.back();
+            free_list.pop_back();
+            return data;
+        }
+
+        if (slab_remaining < size) {
+            slabs.emplace_back(new uint8_t[SLAB_SIZE]);
+            slab_position = slabs.back().get();
+            slab_remaining = SLAB_SIZE;
+        }
+        auto* data = slab_position;
+        slab_position += size;
+        slab_remaining -= size;
+        return data;
+    }
+
+    // 'size' is the capacity returned by allocate().
+    void deallocate(uint8_t* data, std::size_t size) {
+        auto c = size_class(size);
+        if (c == CLASS_COUNT) {
+            delete[] data;
+        } else {
+            free_lists[c].push_back(data);
+        }
+    }
+
+private:
+    static inline std::size_t class_size(std::size_t c) {
+        return MIN_CLASS_SIZE << c;
+    }
+
+    static inline std::size_t size_class(std::size_t size) {
+        std::size_t c = 0;
+        while (c < CLASS_COUNT && class_size(c) < size) {
+            c++;
+        }
+        return c;
+    }
+
+    std::vector<std::unique_ptr<uint8_t[]>> slabs;
+    std::array<std::vector<uint8_t*>, CLASS_COUNT> free_lists;
+    uint8_t* slab_position = nullptr;
+    std::size_t slab_remaining = 0;
+};
+
+// Channel value storage allocated from the ValueArena (subset of std::vector interface),
+// the content of grown storage is not initialized.
+class ValueBuffer
+{
+public:
+    explicit ValueBuffer(ValueArena& arena) : arena(&arena) {}
+
+    ~ValueBuffer() {
+        if (ptr) {
+            arena->deallocate(ptr, capacity_);
+        }
+    }
+
+    ValueBuffer(ValueBuffer&& other) :
+        arena(other.arena), ptr(other.ptr), size_(other.size_), capacity_(other.capacity_) {
+        other.ptr = nullptr;
+        other.size_ = other.capacity_ = 0;
+    }
+
+    ValueBuffer(const ValueBuffer&) = delete;
+    ValueBuffer& operator=(const ValueBuffer&) = delete;
+    ValueBuffer& operator=(ValueBuffer&&) = delete;
+
+    inline uint8_t* data() { return ptr; }
+    inline const uint8_t* data() const { return ptr; }
+    inline std::size_t size() const { return size_; }
+    inline std::size_t capacity() const { return capacity_; }
+    inline const uint8_t* begin() const { return ptr; }
+    inline const uint8_t* end() const { return ptr + size_; }
+
+    void reserve(std::size_t capacity) {
+        if (capacity <= capacity_) {
+            return;
+        }
+        auto* grown = arena->allocate(capacity);
+        if (ptr) {
+            memcpy(grown, ptr, size_);
+            arena->deallocate(ptr, capacity_);
+        }
+        ptr = grown;
+        capacity_ = capacity;
+    }
+
+    inline void resize(std::size_t size) {
+        reserve(size);
+        size_ = size;
+    }
+
+private:
+    ValueArena* arena;
+    uint8_t* ptr = nullptr;
+    std::size_t size_ = 0;
+    std::size_t capacity_ = 0;
+};
+
+// Update queues (channel indices) of priority classes, served either by strict priority
+// or weighted-fair by bytes sent (start-time fair queueing, weights 4:2:1).
+class UpdateQueue
+{
+public:
+    static constexpr std::size_t CLASS_COUNT = 3;
+
+    void configure(PriorityScheduling scheduling) {
+        this->scheduling = scheduling;
+    }
+
+    inline void push(uint32_t index, Priority priority) {
+        auto c = std::size_t(priority);
+        // an idle class does not accumulate credit
+        if (queues[c].empty()) {
+            start_time[c] = std::max(start_time[c], virtual_time);
+        }
+        queues[c].push_back(index);
+    }
+
+    inline std::size_t size() const {
+        std::size_t result = 0;
+        for (auto& queue : queues) {
+            result += queue.size();
+        }
+        return result;
+    }
+
+    inline bool empty(Priority lowest = Priority::low) const {
+        for (std::size_t c = 0; c <= std::size_t(lowest); c++) {
+            if (!queues[c].empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Selects the class to be served next (up to 'lowest'), returns its front entry or nullptr.
+    const uint32_t* front(Priority lowest = Priority::low) {
+        selected = CLASS_COUNT;
+        for (std::size_t c = 0; c <= std::size_t(lowest); c++) {
+            if (queues[c].empty()) {
+                continue;
+            }
+            if (scheduling == PriorityScheduling::strict) {
+                selected = c;
+                break;
+            }
+            if (selected == CLASS_COUNT || start_time[c] < start_time[selected]) {
+                selected = c;
+            }
+        }
+        return (selected < CLASS_COUNT) ? &queues[selected].front() : nullptr;
+    }
+
+    inline const RingBuffer<uint32_t>& queue(std::size_t c) const {
+        return queues[c];
+    }
+
+    inline Priority selected_priority() const {
+        return Priority(selected);
+    }
+
+    // Removes the selected front entry, 'size' bytes were sent.
+    inline void pop(std::size_t size) {
+        queues[selected].pop_front();
+        account(size);
+    }
+
+    // Charges 'size' bytes to the selected class, for entries sent out of order (left queued as stale).
+    inline void account(std::size_t size) {
+        virtual_time = start_time[selected];
+        start_time[selected] += double(size) / weight(selected);
+    }
+
+    // Removes the selected front entry without accounting (stale entry).
+    inline void discard() {
+        queues[selected].pop_front();
+    }
+
+private:
+    static inline double weight(std::size_t c) {
+        return double(1u << (CLASS_COUNT - 1 - c));
+    }
+
+    PriorityScheduling scheduling = PriorityScheduling::strict;
+    std::array<RingBuffer<uint32_t>, CLASS_COUNT> queues;
+    std::array<double, CLASS_COUNT> start_time{};
+    double virtual_time = 0.0;
+    std::size_t selected = CLASS_COUNT;
+};
+
+// Value processing (configured per channel), allocated only when configured.
+struct ValueProcessing
+{
+    Deadband deadband;
+    ArrayTransform array_transform;
+    std::vector<uint8_t> transform_buffer;
+    ValueEncoding encoding;
+    std::vector<uint8_t> encode_buffer;
+};
+
+// Partial (delta) array updates, copy of the value as known by the receiver.
+struct DeltaState
+{
+    uint32_t keyframe_interval = 0;
+    uint32_t deltas_since_keyframe = 0;
+    std::vector<uint8_t> sent_value;
+    long sent_count = -1;
+    uint16_t sent_wire_type = 0;
+};
+
+struct Channel;
+
+// CA callbacks delivered by CA auxiliary threads (preemptive callbacks), handed over to the sender thread.
+// Intrusive lock-free multi-producer single-consumer queue (Vyukov), producers never block.
+// Processed events are returned to a lock-free free ring and reused (with their value buffers),
+// no allocation on the hand-over path once the ring is populated.
+class EventQueue
+{
+public:
+    enum class Kind : uint8_t {
+        event,
+        connected,
+        disconnected
+    };
+
+    struct Event {
+        std::atomic<Event*> next{nullptr};
+        Channel* channel = nullptr;
+        Kind kind = Kind::event;
+        int status = 0;
+        long type = 0;
+        long count = 0;
+        std::vector<uint8_t> dbr;
+    };
+
+    EventQueue() :
+        head(&stub),
+        tail(&stub)
+    {
+    }
+
+    ~EventQueue() {
+        while (auto* event = pop()) {
+            delete event;
+        }
+        for (auto i = free_head.load(); i != free_tail.load(); i++) {
+            delete free_slots[i & (FREE_CAPACITY - 1)].load();
+        }
+    }
+
+    EventQueue(const EventQueue&) = delete;
+    EventQueue& operator=(const EventQueue&) = delete;
+
+    // any thread
+    void push(Event* event) {
+        link(event);
+
+        // wake up the consumer only if it is (about to go) sleeping
+        if (sleeping.load() && sleeping.exchange(false)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_one();
+        }
+    }
+
+    // any thread, a recycled event or a new one (if none is free)
+    Event* acquire() {
+        auto h = free_head.load(std::memory_order_relaxed);
+        while (h != free_tail.load(std::memory_order_acquire)) {
+            // a slot is overwritten only once free_head has moved past it, then the exchange fails
+            Event* event = free_slots[h & (FREE_CAPACITY - 1)].load(std::memory_order_relaxed);
+            if (free_head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return event;
+            }
+        }
+        return new Event();
+    }
+
+    // consumer only, returns a processed event to be reused (deleted if the free ring is full)
+    void recycle(Event* event) {
+        auto t = free_tail.load(std::memory_order_relaxed);
+        if (t - free_head.load(std::memory_order_acquire) == FREE_CAPACITY) {
+            delete event;
+            return;
+        }
+        free_slots[t & (FREE_CAPACITY - 1)].store(event, std::memory_order_relaxed);
+        free_tail.store(t + 1, std::memory_order_release);
+    }
+
+    // consumer only, the returned event is to be recycled
+    Event* pop() {
+        Event* current = tail;
+        Event* next = current->next.load(std::memory_order_acquire);
+        if (current == &stub) {
+            if (!next) {
+                return nullptr;
+            }
+            tail = next;
+            current = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail = next;
+            return current;
+        }
+        // a producer is in the middle of push
+        if (current != head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        link(&stub);
+        next = current->next.load(std::memory_order_acquire);
+        if (next) {
+            tail = next;
+            return current;
+        }
+        return nullptr;
+    }
+
+    // consumer only, waits until an event is pushed or the timeout elapses
+    void wait(std::chrono::duration<double> timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        sleeping.store(true);
+        if (!empty()) {
+            sleeping.store(false);
+            return;
+        }
+        cv.wait_for(lock, timeout, [this]() { return !sleeping.load(); });
+        sleeping.store(false);
+    }
+
+private:
+    inline void link(Event* event) {
+        event->next.store(nullptr, std::memory_order_relaxed);
+        Event* prev = head.exchange(event, std::memory_order_acq_rel);
+        prev->next.store(event);
+    }
+
+    inline bool empty() const {
+        return tail == &stub && !stub.next.load();
+    }
+
+    Event stub;
+    std::atomic<Event*> head;       // last pushed, producers
+    Event* tail;                    // next to pop, consumer only
+
+    // free ring, single producer (consumer of the queue) multiple consumers (producers of the queue);
+    // indices only grow, so a stale index can not be exchanged (no ABA)
+    static constexpr std::size_t FREE_CAPACITY = 256;   // power of two
+    std::array<std::atomic<Event*>, FREE_CAPACITY> free_slots{};
+    std::atomic<uint64_t> free_head{0};     // next free event to take
+    std::atomic<uint64_t> free_tail{0};     // next slot to return an event to, consumer only
+
+    std::atomic<bool> sleeping{false};
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+// State shared by all channels.
+struct ChannelContext
+{
+    UpdateQueue& update_queue;
+    TimingWheel& timing_wheel;
+    ValueArena& value_arena;
+    std::vector<Channel>& channels;
+    EventQueue* event_queue;        // nullptr unless preemptive callbacks are enabled
+};
+
 struct Channel
 {
+    // send path state first
     uint32_t index = 0;
     uint32_t parent_index = 0;        // parent (=channel) index number
-    bool is_polled = false;
-    chid channel_id = NULL;
-    chtype channel_type = TYPENOTCONN;
-    evid event_id = NULL;
+    uint32_t group_end_index = 0;     // last channel of the group (of parent channel only)
+    uint16_t wire_type = 0;           // DBR type as sent (ENCODED_TYPE_FLAG set when encoded)
+    bool pending_update = false;
+    bool pending_refresh = false;     // queued for heartbeat refresh
+    bool in_transfer = false;         // fragmented transfer in progress
+    bool fragment_pending = false;    // updated while in transfer, re-sent once the transfer completes
+    bool deferred_update = false;     // update waiting for min_interval_ticks to elapse (in timing wheel)
+    uint64_t deferred_tick = 0;       // due tick of the deferred update, earlier wheel entries are stale
+    bool generation_valid = false;    // value was sent at least once
+    uint16_t generation = 0;          // seq_no of the message that carried the last sent value
+    Priority priority = Priority::normal;
+    Priority queued_priority = Priority::normal;
+    bool promoted = false;            // alarm severity changed (or disconnected), queued as high priority
+    long count = -1;
+    ValueBuffer value;
+    int updates_since_last_hb = 0;
+    uint64_t min_interval_ticks = 0;  // 0 means no channel update rate limit
+    uint64_t last_send_tick = 0;
+    std::chrono::steady_clock::time_point event_time{};   // time of the last CA event
+    std::chrono::steady_clock::time_point queue_time{};   // time when put to the update queue
 
+    // CA event state
     int status = ECA_DISCONN;
     chtype type = TYPENOTCONN;
-    long count = -1;
-    std::vector<uint8_t> value;
     bool value_hash_initialized = false;
     uint64_t value_hash = 0;
-    bool pending_update = false;
-    int updates_since_last_hb = 0;
+    bool severity_valid = false;
+    dbr_short_t severity = 0;         // last alarm severity of DBR_TIME_* values
+    uint8_t poll_interval = 1;        // polled fields: polled every n-th polling period, backs off while unchanged
+    uint8_t poll_countdown = 1;       // polled fields: polling periods until the next poll
+    DedupMode dedup = DedupMode::none;
+    std::unique_ptr<ValueProcessing> processing;  // nullptr if not configured
+    std::unique_ptr<DeltaState> delta;            // nullptr if partial (delta) array updates are not configured
+
+    // configuration, CA connection
+    bool is_polled = false;
+    bool is_value_only = false;       // field value only (no DBR_TIME_* type)
+    bool variable_length = false;     // subscribe for valid (NORD) array elements only, if supported by the server
+    long event_mask = 0;              // 0 for default
+    chid channel_id = NULL;
+    chtype channel_type = TYPENOTCONN;
+    long element_count = 0;           // native element count (as connected or cached)
+    evid event_id = NULL;
+    long subscribed_count = 0;        // element count of the subscription
 
-    std::deque<std::uint32_t> &update_deque;
-    Channel& parent_channel;
+    ChannelContext& context;
 
     Channel(uint32_t index,
             uint32_t parent_index,
             bool is_polled,
-            std::deque<std::uint32_t> &update_deque,
-            std::vector<Channel>& channels) :
+            ChannelContext& context) :
         index(index),
         parent_index(parent_index),
+        group_end_index(index),
+        value(context.value_arena),
         is_polled(is_polled),
-        update_deque(update_deque),
-        parent_channel((index == parent_index) ? *this : channels[parent_index])
+        context(context)
     {
     }
 
@@ -80,86 +680,136 @@ struct Channel
         return !is_channel();
     }
 
+    inline Channel& parent_channel() {
+        return context.channels[parent_index];
+    }
+
     inline void mark_update() {
         if (is_field()) {
-            parent_channel.mark_update();
+            parent_channel().mark_update();
             return;
         }
-        if (!pending_update) {
-            pending_update = true;
-            updates_since_last_hb++;
-            update_deque.push_back(parent_index);  // Add channel (not field) to update queue 
-       }
+        if (pending_update) {
+            // promoted while queued, re-queue (the stale entry is skipped)
+            if (promoted && queued_priority != Priority::high) {
+                enqueue();
+            }
+            return;
+        }
+
+        // promoted updates are not rate-limited
+        if (deferred_update) {
+            if (!promoted) {
+                return;
+            }
+            deferred_update = false;
+            enqueue();
+            return;
+        }
+
+        queue_time = std::chrono::steady_clock::now();
+        updates_since_last_hb++;
+
+        // rate-limited, defer until minimum interval since the last send elapses
+        if (min_interval_ticks && !promoted) {
+            auto due_tick = last_send_tick + min_interval_ticks;
+            if (due_tick > context.timing_wheel.current_tick()) {
+                deferred_update = true;
+                deferred_tick = due_tick;
+                context.timing_wheel.schedule(parent_index, due_tick);
+                return;
+            }
+        }
+
+        enqueue();
     }
 
-    bool mark_heartbeat_update() {
-        if (is_field()) {
-            return parent_channel.mark_heartbeat_update();
+    // Add channel (not field) to update queue.
+    inline void enqueue() {
+        pending_update = true;
+        queued_priority = promoted ? Priority::high : priority;
+        context.update_queue.push(parent_index, queued_priority);
+    }
+
+    // Called by the timing wheel when a deferred update of the channel is due at 'tick'.
+    void release_deferred_update(uint64_t tick) {
+        // already sent as a promoted update, or entry of such an update (deferred again since)
+        if (!deferred_update || deferred_tick != tick) {
+            return;
+        }
+        deferred_update = false;
+        enqueue();
+    }
+
+    // Called when the entire value was sent.
+    void mark_sent(uint16_t message_seq_no) {
+        generation = message_seq_no;
+        generation_valid = true;
+        // the receiver has the latest value, also when it was within the deadband
+        if (processing) {
+            processing->deadband.sent();
         }
-        bool to_mark = (updates_since_last_hb == 0);
-        if (to_mark) {
-            mark_update();
+        if (delta) {
+            delta->sent_value.assign(value.begin(), value.end());
+            delta->sent_count = count;
+            delta->sent_wire_type = wire_type;
+            delta->deltas_since_keyframe = 0;
         }
+    }
+
+    // Returns true if there was no update since the last check.
+    bool check_heartbeat() {
+        bool stalled = (updates_since_last_hb == 0);
         updates_since_last_hb = 0;
-        return to_mark;
+        return stalled;
     }
 
-    // Assumes 'channel' is on the front of the update_deque.
-    void clear_update() {
+    // Assumes 'channel' is the front entry selected by the update_queue,
+    // otherwise ('queue_front' false) it was sent out of order and its entry is skipped later.
+    void clear_update(std::size_t size, bool queue_front = true) {
         if (is_field()) {
-            parent_channel.clear_update();
+            parent_channel().clear_update(size, queue_front);
             return;
         }
-        update_deque.pop_front();
+        if (queue_front) {
+            context.update_queue.pop(size);
+        } else {
+            context.update_queue.account(size);
+        }
         pending_update = false;
+        promoted = false;
+        last_send_tick = context.timing_wheel.current_tick();
     }
 
 };
 
+// Record channel and its extra fields, sent together.
 struct ChannelGroup 
 {
-    const std::vector<Channel>& channels;
     const uint32_t start_index;
     const uint32_t end_index;
-
-    inline uint32_t start_channel_group_id(const Channel& channel) const {
-        return channel.parent_index;
-    }
-
-    inline uint32_t end_channel_group_id(const Channel& channel) const {
-        for (auto i = channel.index; i < channels.size()-1; i++) {
-            if (channels[i].parent_index < channels[i+1].parent_index) {
-                return i;
-            }
-        }
-        return channels.size() - 1;
-    }
+    uint32_t total_value_size = 0;
+    uint32_t total_value_size_aligned = 0;
 
     ChannelGroup(const Channel& channel, const std::vector<Channel>& channels) :
-        channels(channels),
-        start_index(start_channel_group_id(channel)),
-        end_index(end_channel_group_id(channel))
+        start_index(channel.parent_index),
+        end_index(channels[channel.parent_index].group_end_index)
     {
+        // one pass over the group, each value is 8-byte aligned
+        constexpr std::size_t alignment = SubmessageHeader::alignment;
+        for (auto i = start_index; i < end_index+1; i++) {
+            auto size = channels[i].value.size();
+            total_value_size += size;
+            total_value_size_aligned += (CAChannelData::size + size + alignment - 1) & ~(alignment - 1);
+        }
     }
 
     inline uint32_t value_size() const {
-        uint32_t sum = 0;
-        for (auto i = start_index; i < end_index+1; i++) {
-            sum += channels[i].value.size();
-        }
-        return sum;
+        return total_value_size;
     }
 
-    inline uint32_t value_size_aligned(std::size_t alignment) const {
-        uint32_t full_aligned_size = 0;
-        for (auto i = start_index; i < end_index+1; i++) {
-            full_aligned_size += (CAChannelData::size + channels[i].value.size());
-            auto n = full_aligned_size % alignment;
-            if (n > 0) {
-                full_aligned_size += (alignment - n);
-            }
-        }
-        return full_aligned_size;
+    inline uint32_t value_size_aligned() const {
+        return total_value_size_aligned;
     }
 
     inline uint32_t count() const {
@@ -167,8 +817,73 @@ struct ChannelGroup
     }
 };
 
+// Paced transport shared by all the sender shards, one transmit lane (and seq_no stream) per shard,
+// and per shard of each destination. The transmit queue is either owned or shared with other senders.
+struct Sender::Transport {
+    Transport(const epics_diode::Config& config, const std::string& send_addresses, std::size_t shard_count);
+    Transport(const epics_diode::Config& config, const std::string& send_addresses, std::size_t shard_count,
+              TransmitQueue& shared_transmitter, double weight);
+
+    Transport(const Transport&) = delete;
+    Transport& operator=(const Transport&) = delete;
+
+    // lane of a shard stream
+    inline std::size_t lane(std::size_t shard) const {
+        return first_lane + shard;
+    }
+
+    // lane of a shard stream of a destination, destination streams follow the streams of the entire configuration
+    inline std::size_t lane(std::size_t shard, std::size_t destination_index) const {
+        return first_lane + (destination_index + 1) * shard_count + shard;
+    }
+
+    Logger logger;
+    const uint64_t startup_time;
+    const std::size_t shard_count;
+    const std::vector<Destination> destinations;
+    const std::vector<osiSockAddr> addresses;       // send addresses of the entire configuration
+    const std::unique_ptr<UDPSender> sender;                // null if shared
+    const std::unique_ptr<TransmitQueue> own_transmitter;   // null if shared
+    TransmitQueue& transmitter;     // rate-limited sending, decoupled from CA event processing
+    const std::size_t first_lane;
+
+private:
+    static uint64_t current_time_millis();
+    std::vector<osiSockAddr> initialize_addresses(const std::string& send_address_list, const Config& config);
+    std::vector<Destination> create_destinations(const Config& config);
+    std::vector<std::vector<Serializer::value_type>> preset_headers(const Config& config) const;
+    std::vector<std::vector<osiSockAddr>> lane_addresses() const;
+    static void complete_timestamp(uint8_t* packet, std::size_t offset, std::chrono::microseconds delay);
+};
+
+Sender::Transport::Transport(const epics_diode::Config& config, const std::string& send_addresses, std::size_t shard_count) :
+    logger("sender"),
+    startup_time(current_time_millis()),
+    shard_count(shard_count),
+    destinations(create_destinations(config)),
+    addresses(initialize_addresses(send_addresses, config)),
+    sender(new UDPSender(addresses, config.rate_limit_mbs)),
+    own_transmitter(new TransmitQueue(*sender, config.transmit_buffers, MAX_MESSAGE_SIZE)),
+    transmitter(*own_transmitter),
+    first_lane(transmitter.add_lanes(preset_headers(config), complete_timestamp, lane_addresses()))
+{
+    transmitter.start();
+}
+
+Sender::Transport::Transport(const epics_diode::Config& config, const std::string& send_addresses, std::size_t shard_count,
+                             TransmitQueue& shared_transmitter, double weight) :
+    logger("sender"),
+    startup_time(current_time_millis()),
+    shard_count(shard_count),
+    destinations(create_destinations(config)),
+    addresses(initialize_addresses(send_addresses, config)),
+    transmitter(shared_transmitter),
+    first_lane(transmitter.add_lanes(preset_headers(config), complete_timestamp, lane_addresses(), weight))
+{
+}
+
 struct Sender::Impl {
-    Impl(const epics_diode::Config& config, const std::string& send_addresses);
+    Impl(const epics_diode::Config& config, Transport& transport, uint8_t stream_id, uint32_t channel_offset);
     ~Impl();
 
     Impl(const Impl&) = delete;
@@ -177,121 +892,720 @@ struct Sender::Impl {
     Impl& operator=(const Impl&) = delete;
     Impl& operator=(Impl&& other) = delete;
 
-    void run(double runtime);
+    // runs until 'stop' (if set) is raised by another shard
+    void run(double runtime, const std::atomic<bool>* stop = nullptr);
 
 private:
+    friend struct SenderBenchmark;
+    friend struct SenderTest;
+
     Logger logger;
     
-    static constexpr double MIN_UPDATE_PERIOD = 0.025;
     static constexpr double MIN_POLLED_FIELDS_UPDATE_PERIOD = 3.0;
     static constexpr double MIN_HB_PERIOD = 0.1;
+    static constexpr double MIN_HB_BANDWIDTH_SHARE = 0.01;
+    static constexpr double MIN_FRAGMENT_BANDWIDTH_SHARE = 0.01;
+    static constexpr double FLUSH_CHECK_PERIOD = 0.005;
+    static constexpr double MIN_LATENCY_BUDGET = 0.001;
 
-    UDPSender initialize_sender(const std::string& send_address_list, const Config& config);
-    void create_channel(std::vector<Channel>& channels, const std::string channel_name, uint32_t channel_num, uint32_t channel_parent_num, const bool is_polled);
+    static std::string ca_channel_name(const ConfigChannel& config_channel);
+    void create_channel(std::vector<Channel>& channels, const std::string channel_name, uint32_t channel_num, uint32_t channel_parent_num, const bool is_polled, const ConfigChannel& config_channel);
     std::vector<Channel> create_channels(const Config& config);
     
     void send_updates();
-    void send_fragmented_updates();
-    void send_fragmented_update(Channel* ch);
-    void check_polled_fields();
-    void mark_heartbeat_updates();
+    void commit(std::size_t length, std::size_t prepare_offset = 0);
+    void wait_and_flush();
+    void wait_events();
+    void pend_event(double timeout);
+    void process_queued_events();
+    void flush(Priority lowest);
+    bool packet_full() const;
+    std::chrono::steady_clock::time_point oldest_update_time() const;
+#ifndef _WIN32
+    static void fd_registration_handler(void* arg, int fd, int opened);
+#endif
+    void start_fragmented_transfer(Channel* ch);
+    bool send_next_fragment();
+    void send_fragments(bool interleaved);
+    void write_fragment(Serializer& s);
+    std::size_t fragment_tail_size();
+    void write_beacon(Serializer& s);
+    bool prepare_delta(const Channel& ch);
+    void send_delta_update(Channel* ch);
+    void poll_fields();
+    void complete_poll_batch();
+    void release_deferred_updates();
+    void advance_heartbeat_carousel();
+    void report_heartbeat_cycle();
+    void connect_channels();
+    void subscribe_cached(Channel& ch, chtype type, long count);
+    void report_connection_progress();
+    void load_channel_cache();
+    void save_channel_cache();
+    bool lightweight_refresh(const ChannelGroup& cg) const;
+    bool needs_fragmentation(const ChannelGroup& cg) const;
+    void send_beacon();
+
+    // channel id as sent, unique across the shards
+    inline uint32_t wire_id(const Channel& ch) const {
+        return ch.index + channel_offset;
+    }
 
     inline bool has_updates() {
-        return !update_deque.empty();
+        return next_channel_update() != nullptr;
     }
 
     Channel* next_channel_update() {
-        if (update_deque.empty()) {
+        // only up to flush_lowest class when flushing
+        const uint32_t* index;
+        while ((index = update_queue.front(flushing ? flush_lowest : Priority::low))) {
+            Channel* ch = &channels[*index];
+            if (ch->pending_update && ch->queued_priority == update_queue.selected_priority()) {
+                return ch;
+            }
+            // channel was promoted (re-queued) or already sent
+            update_queue.discard();
+        }
+
+        if (flushing) {
             return nullptr;
         }
 
-        uint32_t index = update_deque.front();
+        // heartbeat refreshes are sent only when there are no fresh updates, within bandwidth budget
+        while (refresh_budget > 0 && !refresh_deque.empty()) {
+            Channel* ch = &channels[refresh_deque.front()];
+            // skip if updated in the meantime
+            if (ch->updates_since_last_hb == 0) {
+                return ch;
+            }
+            refresh_deque.pop_front();
+            ch->pending_refresh = false;
+        }
 
-        Channel* ch = &channels[index];
-        return ch;
+        return nullptr;
+    }
+
+    // Assumes 'channel' is the one returned by next_channel_update().
+    void clear_update(Channel* ch, std::size_t size) {
+        if (ch->pending_update) {
+            ch->clear_update(size);
+        } else {
+            refresh_deque.pop_front();
+            ch->pending_refresh = false;
+            refresh_budget -= int64_t(size);
+        }
     }
 
     double update_period;
     double polled_fields_update_period;
     double heartbeat_period;
+    double beacon_period;
+    double heartbeat_bandwidth_share;
+    double full_refresh_period;
+    bool latency_telemetry;
+    bool variable_length_arrays;
+    bool immediate_flush;           // send high priority updates without waiting for the update period
+    double latency_budget;          // 0 means updates are sent once per update period
+    std::size_t reorder_window;     // queued updates looked ahead to fill a message, 0 for FIFO order only
+    bool flushing = false;          // sending between update periods, no heartbeats
+    Priority flush_lowest = Priority::low;
+#ifndef _WIN32
+    std::vector<pollfd> ca_fds;     // CA file descriptors, signal pending CA activity
+#endif
 
     uint64_t iteration = 0;
     const uint64_t pf_iterations;
-    const uint64_t hb_iterations;
-
-    std::vector<Serializer::value_type> send_buffer;  
-    UDPSender sender;
+    const uint64_t beacon_iterations;   // 0 means beacons are disabled
+    bool beacon_pending = false;        // appended to the last update message of the period if it fits
+
+    // adaptive polling, visits a slice of polled fields every update period, gets are batched in a sync group
+    struct PolledGet {
+        uint32_t index = 0;
+        chtype type = TYPENOTCONN;
+        unsigned long count = 0;
+        std::vector<uint8_t> buffer;
+    };
+
+    static constexpr uint8_t MAX_POLL_BACKOFF = 16;     // polling periods
+    std::vector<uint32_t> polled_channels;
+    std::size_t poll_slice = 1;
+    std::size_t poll_position = 0;
+    bool poll_group_valid = false;
+    CA_SYNC_GID poll_group = 0;
+    std::vector<PolledGet> poll_batch;                  // gets of the sync group, buffers are reused
+    std::size_t poll_batch_size = 0;                    // 0 if no gets in progress
+    uint64_t poll_batch_iteration = 0;
+
+    // staged startup, CA channels are created connect_batch_size per update period (search batching)
+    struct PendingConnect {
+        uint32_t index;
+        std::string name;
+    };
+
+    struct CachedChannel {
+        chtype type;
+        long count;
+    };
+
+    std::vector<PendingConnect> pending_connects;
+    std::size_t connect_position = 0;
+    const std::size_t connect_batch_size;               // 0 means all at once
+    std::string channel_cache_file;                     // empty if disabled
+    std::unordered_map<std::string, CachedChannel> channel_cache;   // last known native type and count
+    const std::chrono::steady_clock::time_point startup_clock;
+    bool full_state = false;                            // all channels connected and sent
+    const uint64_t progress_iterations;
+    static constexpr double STARTUP_REPORT_WINDOW = 60.0;   // seconds, progress is logged at debug level afterwards
+    static constexpr uint32_t MAX_PROGRESS_BACKOFF = 64;    // progress checks between reports while stalled
+    uint32_t progress_interval = 1;                     // progress checks between reports, doubles while stalled
+    uint32_t progress_countdown = 1;
+    std::size_t reported_connected = 0;
+    std::size_t reported_received = 0;
+
+    // heartbeat carousel, visits a slice of channels every update period
+    std::size_t carousel_slice = 1;
+    std::size_t carousel_position = 0;
+    std::size_t carousel_connected = 0;
+    std::size_t carousel_refreshed = 0;
+    uint64_t carousel_cycle = 0;
+    const uint64_t full_refresh_cycles;         // 0 means unchanged values are always re-sent in full
+    const int64_t refresh_budget_per_period;    // bytes
+    int64_t refresh_budget = 0;
+
+    // fragmented (large) values, sent interleaved with regular updates
+    struct FragmentedTransfer {
+        uint32_t channel_index;
+        bool started = false;
+        uint16_t seq_no = 0;
+        uint16_t fragment_seq_no = 0;
+        uint32_t count = 0;
+        uint16_t wire_type = 0;
+        std::size_t offset = 0;
+        std::vector<uint8_t> value;     // snapshot of the value
+
+        explicit FragmentedTransfer(uint32_t channel_index) : channel_index(channel_index) {}
+    };
+
+    static constexpr std::size_t MAX_ACTIVE_TRANSFERS = 4;
+    std::deque<FragmentedTransfer> transfers;           // the first MAX_ACTIVE_TRANSFERS are active
+    std::vector<std::vector<uint8_t>> transfer_buffers; // reused snapshot buffers
+    std::size_t transfer_cursor = 0;
+    const int64_t fragment_budget_per_period;           // bytes
+    int64_t fragment_budget = 0;
+
+    const uint64_t startup_time;
+    TransmitQueue& transmitter;     // shared by all the shards
+    const uint8_t stream_id;        // shard number and seq_no stream
+    const std::size_t lane;         // transmit lane of the shard stream
+    const uint32_t channel_offset;  // (global) channel id of the first channel of the shard
+    std::vector<DestinationStream> destination_streams;     // channel subsets, derived from every committed message
 
     uint16_t seq_no = 0;
 
-    std::deque<std::uint32_t> update_deque{};
+    std::unique_ptr<EventQueue> event_queue;    // preemptive callbacks only
+    ValueArena value_arena;
+    UpdateQueue update_queue{};
+    RingBuffer<std::uint32_t> refresh_deque{};    // heartbeat refreshes, lower priority than update_queue
+    TimingWheel timing_wheel;
     std::vector<Channel> channels;
+    ChannelContext channel_context{update_queue, timing_wheel, value_arena, channels, event_queue.get()};
+    std::vector<std::uint32_t> message_channels;   // channels in the current message, for telemetry
+    std::vector<CAChannelRefresh> message_refreshes;   // refreshes of unchanged values in the current message
+    std::vector<CADeltaRange> delta_ranges;             // changed ranges of a delta update
 
     friend struct Channel;
 };
 
-Sender::Impl::Impl(const epics_diode::Config& config, const std::string& send_addresses) :
+Sender::Impl::Impl(const epics_diode::Config& config, Transport& transport, uint8_t stream_id, uint32_t channel_offset) :
     logger("sender"),
-    update_period(std::max(config.min_update_period, MIN_UPDATE_PERIOD)),
+    update_period(config.effective_update_period()),
     polled_fields_update_period(std::max(config.polled_fields_update_period, MIN_POLLED_FIELDS_UPDATE_PERIOD)),
     heartbeat_period(std::max(config.heartbeat_period, MIN_HB_PERIOD)),
+    beacon_period(config.effective_beacon_period()),
+    heartbeat_bandwidth_share(std::min(std::max(config.heartbeat_bandwidth_share, MIN_HB_BANDWIDTH_SHARE), 1.0)),
+    full_refresh_period((config.full_refresh_period > 0) ? std::max(config.full_refresh_period, heartbeat_period) : 0.0),
+    latency_telemetry(config.latency_telemetry),
+    variable_length_arrays(config.variable_length_arrays),
+    immediate_flush(config.immediate_flush),
+    latency_budget((config.latency_budget > 0) ? std::max(config.latency_budget, MIN_LATENCY_BUDGET) : 0.0),
+    reorder_window(config.reorder_window),
     pf_iterations(std::max(uint64_t(1), uint64_t(std::round(polled_fields_update_period / update_period)))),
-    hb_iterations(std::max(uint64_t(1), uint64_t(std::round(heartbeat_period / update_period)))),
-    send_buffer(MAX_MESSAGE_SIZE),
-    sender(initialize_sender(send_addresses, config))
+    beacon_iterations((beacon_period > 0) ? std::max(uint64_t(1), uint64_t(std::round(beacon_period / update_period))) : 0),
+    connect_batch_size(config.connect_batch_size),
+    channel_cache_file(config.channel_cache),
+    startup_clock(std::chrono::steady_clock::now()),
+    progress_iterations(std::max(uint64_t(1), uint64_t(std::round(1.0 / update_period)))),
+    full_refresh_cycles((full_refresh_period > 0) ? uint64_t(std::round(full_refresh_period / heartbeat_period)) : 0),
+    refresh_budget_per_period((config.rate_limit_mbs > 0) ?
+        int64_t(heartbeat_bandwidth_share * config.rate_limit_mbs * 1e6 * update_period) :
+        std::numeric_limits<int64_t>::max()),
+    fragment_budget_per_period((config.rate_limit_mbs > 0) ?
+        int64_t(std::min(std::max(config.fragment_bandwidth_share, MIN_FRAGMENT_BANDWIDTH_SHARE), 1.0) *
+                config.rate_limit_mbs * 1e6 * update_period) :
+        std::numeric_limits<int64_t>::max()),
+    startup_time(transport.startup_time),
+    transmitter(transport.transmitter),
+    stream_id(stream_id),
+    lane(transport.lane(stream_id)),
+    channel_offset(channel_offset),
+    event_queue(config.preemptive_callbacks ? new EventQueue() : nullptr)
 {
+    destination_streams.reserve(transport.destinations.size());
+    for (std::size_t i = 0; i < transport.destinations.size(); i++) {
+        destination_streams.emplace_back(transport.destinations[i], transport.lane(stream_id, i));
+    }
+
     logger.log(LogLevel::Config, "Update period %.3fs, heartbeat period %.1fs.",
                 update_period, heartbeat_period);
+    if (beacon_iterations) {
+        logger.log(LogLevel::Config, "Beacon period %.3fs.", beacon_period);
+    }
+    if (full_refresh_cycles) {
+        logger.log(LogLevel::Config, "Full refresh period of unchanged values %.1fs.", full_refresh_period);
+    }
+    if (latency_telemetry) {
+        logger.log(LogLevel::Config, "Latency telemetry enabled.");
+    }
+    update_queue.configure(config.priority_scheduling);
+    logger.log(LogLevel::Config, "%s priority scheduling%s.",
+                (config.priority_scheduling == PriorityScheduling::strict) ? "Strict" : "Weighted-fair",
+                immediate_flush ? ", immediate flush of high priority updates" : "");
 
     // Start up Channel Access.
     logger.log(LogLevel::Info, "Initializing CA.");
-    int result = ca_context_create(ca_disable_preemptive_callback);
+    int result = ca_context_create(event_queue ? ca_enable_preemptive_callback : ca_disable_preemptive_callback);
     if (result != ECA_NORMAL) {
         throw std::runtime_error(std::string("Failed to initialize Channel Access: ") + ca_message(result));
     }
+    if (event_queue) {
+        logger.log(LogLevel::Config, "Preemptive CA callbacks enabled.");
+    }
 
-    // Create channels.
+    // event-driven loop, CA file descriptors are polled for activity (callbacks are dispatched by ca_poll)
+    if (latency_budget > 0) {
+        logger.log(LogLevel::Config, "Latency budget %.3fs.", latency_budget);
+    }
+#ifndef _WIN32
+    if (latency_budget > 0 && !event_queue) {
+        result = ca_add_fd_registration(fd_registration_handler, this);
+        if (result != ECA_NORMAL) {
+            throw std::runtime_error(std::string("Failed to register CA file descriptor handler: ") + ca_message(result));
+        }
+    }
+#endif
+
+    // Create channels, CA channels are created in batches (see connect_channels).
+    if (!channel_cache_file.empty()) {
+        // each shard has its own cache
+        if (stream_id) {
+            channel_cache_file += "." + std::to_string(stream_id);
+        }
+        load_channel_cache();
+    }
     channels = create_channels(config);
+    if (connect_batch_size) {
+        logger.log(LogLevel::Config, "Creating up to %zu CA channels per update period.", connect_batch_size);
+    }
+    connect_channels();
+
+    // Wheel must cover the longest channel minimum update period.
+    uint64_t max_interval_ticks = 0;
+    for (auto& channel : channels) {
+        max_interval_ticks = std::max(max_interval_ticks, channel.min_interval_ticks);
+    }
+    if (max_interval_ticks) {
+        timing_wheel.resize(max_interval_ticks + 1);
+        logger.log(LogLevel::Config, "Channel update rate limits up to %.3fs.", max_interval_ticks * update_period);
+    }
+
+    // Poll all the polled fields within one polling period, spread evenly over the period.
+    for (auto& channel : channels) {
+        if (channel.is_polled) {
+            polled_channels.push_back(channel.index);
+        }
+    }
+    if (!polled_channels.empty()) {
+        result = ca_sg_create(&poll_group);
+        if (result != ECA_NORMAL) {
+            throw std::runtime_error(std::string("Failed to create CA synchronous group: ") + ca_message(result));
+        }
+        poll_group_valid = true;
+        poll_slice = (polled_channels.size() + pf_iterations - 1) / pf_iterations;
+        logger.log(LogLevel::Config, "Polling %zu field(s), %zu per update period, back-off up to %u polling periods.",
+                    polled_channels.size(), poll_slice, MAX_POLL_BACKOFF);
+    }
+
+    // Visit all the channels within one heartbeat period.
+    carousel_slice = std::max(std::size_t(1),
+        std::size_t(std::ceil(channels.size() * update_period / heartbeat_period)));
+    if (config.rate_limit_mbs > 0) {
+        logger.log(LogLevel::Config, "Heartbeat carousel: %zu channel(s) per update period, %.0f%% bandwidth share.",
+                    carousel_slice, heartbeat_bandwidth_share * 100);
+    } else {
+        logger.log(LogLevel::Config, "Heartbeat carousel: %zu channel(s) per update period.", carousel_slice);
+    }
 }
 
 Sender::Impl::~Impl() {
+    if (!channel_cache_file.empty()) {
+        save_channel_cache();
+    }
+
+    if (poll_group_valid) {
+        ca_sg_delete(poll_group);
+    }
+
     // Clear channels first and then shutdown CA.
     channels.clear();
     ca_context_destroy();
 }
 
-void Sender::Impl::run(double runtime) {
+namespace {
+
+template<typename T>
+inline void dbr_values_to_double(const void* dbr, long type, long count, std::vector<double>& values) {
+    auto* ptr = static_cast<const T*>(dbr_value_ptr(dbr, type));
+    values.assign(ptr, ptr + count);
+}
+
+}
+
+template<typename T>
+inline T from_mean(double mean, std::true_type /* is_integral */) {
+    return T(std::lround(mean));
+}
+
+template<typename T>
+inline T from_mean(double mean, std::false_type /* is_integral */) {
+    return T(mean);
+}
+
+template<typename T>
+void bin_values(const void* src, long n, long bin_size, void* dst, ArrayBinning binning) {
+    auto* in = static_cast<const T*>(src);
+    auto* out = static_cast<T*>(dst);
+    for (long i = 0; i < n; i += bin_size) {
+        auto* end = in + std::min(i + bin_size, n);
+        switch (binning) {
+            case ArrayBinning::min: *out++ = *std::min_element(in + i, end); break;
+            case ArrayBinning::max: *out++ = *std::max_element(in + i, end); break;
+            case ArrayBinning::mean:
+                *out++ = from_mean<T>(std::accumulate(in + i, end, 0.0) / (end - (in + i)), std::is_integral<T>());
+                break;
+            default: *out++ = in[i]; break;
+        }
+    }
+}
+
+long ArrayTransform::apply(long type, const void* dbr, long dbr_count, std::vector<uint8_t>& value) const
+{
+    // at least one element is always sent
+    long first = std::min(long(offset), std::max(dbr_count - 1, 0L));
+    long n = dbr_count - first;
+    if (count) {
+        n = std::min(n, long(count));
+    }
+    long result_count = std::max((n + long(stride) - 1) / long(stride), 1L);
+
+    auto value_offset = dbr_value_offset[type];
+    auto element_size = dbr_value_size[type];
+
+    value.resize(dbr_size_n(type, result_count));
+
+    // status, severity, timestamp
+    auto* src = static_cast<const uint8_t*>(dbr);
+    memcpy(value.data(), src, value_offset);
+    src += value_offset + first * element_size;
+    auto* dst = value.data() + value_offset;
+
+    if (n <= 0) {
+        memcpy(dst, src, element_size);
+        return result_count;
+    }
+
+    // binning of numeric values only, otherwise decimation
+    auto binning_type = (binning == ArrayBinning::none) ? -1 : dbf_type_to_DBR(dbr_type_to_DBF(type));
+    switch (binning_type) {
+        case DBR_SHORT: bin_values<dbr_short_t>(src, n, stride, dst, binning); break;
+        case DBR_FLOAT: bin_values<dbr_float_t>(src, n, stride, dst, binning); break;
+        case DBR_CHAR: bin_values<dbr_char_t>(src, n, stride, dst, binning); break;
+        case DBR_LONG: bin_values<dbr_long_t>(src, n, stride, dst, binning); break;
+        case DBR_DOUBLE: bin_values<dbr_double_t>(src, n, stride, dst, binning); break;
+        default:
+            for (long i = 0; i < result_count; i++) {
+                memcpy(dst + i * element_size, src + i * stride * element_size, element_size);
+            }
+            break;
+    }
+
+    return result_count;
+}
+
+bool Deadband::check(long type, const void* dbr, long count)
+{
+    switch (type) {
+        case DBR_TIME_SHORT: dbr_values_to_double<dbr_short_t>(dbr, type, count, values); break;
+        case DBR_TIME_FLOAT: dbr_values_to_double<dbr_float_t>(dbr, type, count, values); break;
+        case DBR_TIME_CHAR: dbr_values_to_double<dbr_char_t>(dbr, type, count, values); break;
+        case DBR_TIME_LONG: dbr_values_to_double<dbr_long_t>(dbr, type, count, values); break;
+        case DBR_TIME_DOUBLE: dbr_values_to_double<dbr_double_t>(dbr, type, count, values); break;
+        default:
+            // non-numeric (string, enum) values
+            return true;
+    }
+
+    // status and severity are at the same offset for all DBR_TIME_* types
+    auto* time_dbr = static_cast<const dbr_time_short*>(dbr);
+
+    bool pass = !reference_valid ||
+                time_dbr->status != status || time_dbr->severity != severity ||
+                values.size() != reference.size();
+
+    // note: NaN differences always pass
+    if (!pass) {
+        if (per_element) {
+            for (std::size_t i = 0; i < values.size(); i++) {
+                if (!(std::abs(values[i] - reference[i]) <= std::max(abs, rel * std::abs(reference[i])))) {
+                    pass = true;
+                    break;
+                }
+            }
+        } else {
+            double max_diff = 0.0;
+            double max_reference = 0.0;
+            for (std::size_t i = 0; i < values.size(); i++) {
+                auto diff = std::abs(values[i] - reference[i]);
+                if (std::isnan(diff)) {
+                    max_diff = diff;
+                    break;
+                }
+                max_diff = std::max(max_diff, diff);
+                max_reference = std::max(max_reference, std::abs(reference[i]));
+            }
+            pass = !(max_diff <= std::max(abs, rel * max_reference));
+        }
+    }
+
+    if (pass) {
+        reference.swap(values);
+        status = time_dbr->status;
+        severity = time_dbr->severity;
+        reference_valid = true;
+        suppressed = false;
+    } else {
+        suppressed = true;
+        suppressed_status = time_dbr->status;
+        suppressed_severity = time_dbr->severity;
+    }
+    return pass;
+}
+
+void Sender::Impl::run(double runtime, const std::atomic<bool>* stop) {
 
     // Process CA events forever, or specified amount of time.
     auto iterations = uint64_t(std::round(runtime / update_period));
     while (1) {
-        ca_pend_event(update_period);
+        if (latency_budget > 0) {
+            wait_events();
+        } else if (immediate_flush) {
+            wait_and_flush();
+        } else {
+            pend_event(update_period);
+        }
 
         ++iteration;
 
-        // check for polled fields
-        if (iteration % pf_iterations == 0) {
-            check_polled_fields();
-        }
+        // release rate-limited updates that are due
+        release_deferred_updates();
 
-        // mark stalled updates to be send
-        if (iteration % hb_iterations == 0) {
-            mark_heartbeat_updates();
-        }
+        // staged startup
+        connect_channels();
+        report_connection_progress();
+
+        // poll a slice of polled fields
+        poll_fields();
+
+        // mark a slice of stalled channels to be re-sent
+        advance_heartbeat_carousel();
+
+        // unused budget is not carried over (no bursts), overdraft is
+        fragment_budget = std::min(fragment_budget, int64_t(0)) + fragment_budget_per_period;
+
+        // link liveness beacon, appended to the last update message (reports actual seq_no) or sent after updates
+        beacon_pending = (beacon_iterations && iteration % beacon_iterations == 0);
 
         send_updates();
 
+        if (beacon_pending) {
+            send_beacon();
+        }
+
         // runtime check
         if (runtime > 0 && iteration >= iterations) {
             break;
         }
+        if (stop && stop->load()) {
+            break;
+        }
+    }
+}
+
+void Sender::Impl::wait_and_flush()
+{
+    using secs = std::chrono::duration<double>;
+
+    // process CA events in short slices, send high priority updates as soon as they are queued
+    auto deadline = std::chrono::steady_clock::now() + secs(update_period);
+    while (1) {
+        double remaining = secs(deadline - std::chrono::steady_clock::now()).count();
+        // note: 0 would block forever
+        if (remaining < 1e-6) {
+            break;
+        }
+        pend_event(std::min(remaining, FLUSH_CHECK_PERIOD));
+
+        if (!update_queue.empty(Priority::high)) {
+            flush(Priority::high);
+        }
+    }
+}
+
+void Sender::Impl::wait_events()
+{
+    using secs = std::chrono::duration<double>;
+    using clock_type = std::chrono::steady_clock;
+
+    // the update period is an upper bound, updates are sent when a packet is full
+    // or the oldest queued update reaches the latency budget
+    const auto budget = std::chrono::duration_cast<clock_type::duration>(secs(latency_budget));
+    const auto deadline = clock_type::now() + std::chrono::duration_cast<clock_type::duration>(secs(update_period));
+    while (1) {
+        auto now = clock_type::now();
+        if (now >= deadline) {
+            break;
+        }
+
+        auto wakeup = deadline;
+        if (!update_queue.empty()) {
+            wakeup = std::min(wakeup, oldest_update_time() + budget);
+        }
+        double timeout = std::max(secs(wakeup - now).count(), 0.0);
+        if (event_queue) {
+            // events are queued by CA auxiliary threads
+            event_queue->wait(secs(timeout));
+            process_queued_events();
+        } else {
+#ifndef _WIN32
+            int result = poll(ca_fds.data(), ca_fds.size(), int(std::ceil(timeout * 1000)));
+            if (result < 0 && errno != EINTR) {
+                logger.log(LogLevel::Error, "Failed to poll CA file descriptors: %s.", strerror(errno));
+                ca_pend_event(std::max(secs(deadline - clock_type::now()).count(), MIN_LATENCY_BUDGET));
+                break;
+            }
+
+            // dispatch pending CA callbacks
+            ca_poll();
+#else
+            // no CA file descriptor polling, callbacks are dispatched in slices of the latency budget
+            // note: 0 would block forever
+            ca_pend_event(std::max(std::min(timeout, latency_budget), MIN_LATENCY_BUDGET));
+#endif
+        }
+
+        if (immediate_flush && !update_queue.empty(Priority::high)) {
+            flush(Priority::high);
+        }
+
+        if (!update_queue.empty() &&
+            (packet_full() || clock_type::now() - oldest_update_time() >= budget)) {
+            flush(Priority::low);
+        }
+    }
+}
+
+void Sender::Impl::pend_event(double timeout)
+{
+    if (!event_queue) {
+        ca_pend_event(timeout);
+        return;
+    }
+
+    // events are queued by CA auxiliary threads, process them as they arrive
+    using secs = std::chrono::duration<double>;
+    auto deadline = std::chrono::steady_clock::now() + secs(timeout);
+    while (1) {
+        process_queued_events();
+
+        auto remaining = secs(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) {
+            break;
+        }
+        event_queue->wait(remaining);
+    }
+    ca_flush_io();
+}
+
+void Sender::Impl::flush(Priority lowest)
+{
+    flushing = true;
+    flush_lowest = lowest;
+    send_updates();
+    flushing = false;
+}
+
+bool Sender::Impl::packet_full() const
+{
+    constexpr std::size_t capacity = MAX_MESSAGE_SIZE - Header::size - SubmessageHeader::size - CADataMessage::size;
+
+    std::size_t size = 0;
+    for (std::size_t c = 0; c < UpdateQueue::CLASS_COUNT; c++) {
+        auto& queue = update_queue.queue(c);
+        for (std::size_t i = 0; i < queue.size(); i++) {
+            size += ChannelGroup(channels[queue[i]], channels).value_size_aligned();
+            if (size >= capacity) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+std::chrono::steady_clock::time_point Sender::Impl::oldest_update_time() const
+{
+    // queues are FIFO, the oldest update of each class is at the front
+    auto oldest = std::chrono::steady_clock::time_point::max();
+    for (std::size_t c = 0; c < UpdateQueue::CLASS_COUNT; c++) {
+        auto& queue = update_queue.queue(c);
+        if (!queue.empty()) {
+            oldest = std::min(oldest, channels[queue.front()].queue_time);
+        }
+    }
+    return oldest;
+}
+
+#ifndef _WIN32
+void Sender::Impl::fd_registration_handler(void* arg, int fd, int opened)
+{
+    auto* impl = static_cast<Sender::Impl*>(arg);
+    auto& fds = impl->ca_fds;
+    if (opened) {
+        fds.push_back(pollfd{fd, POLLIN, 0});
+    } else {
+        fds.erase(std::remove_if(fds.begin(), fds.end(),
+                                 [fd](const pollfd& p) { return p.fd == fd; }),
+                  fds.end());
     }
 }
+#endif
 
-UDPSender Sender::Impl::initialize_sender(const std::string& send_address_list, const Config& config)
+uint64_t Sender::Transport::current_time_millis()
 {
-    assert(send_buffer.size() % SubmessageHeader::alignment == 0);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
 
+std::vector<osiSockAddr> Sender::Transport::initialize_addresses(const std::string& send_address_list, const Config& config)
+{
     auto addresses = parse_socket_address_list(send_address_list, EPICS_DIODE_DEFAULT_PORT);
 
     logger.log(LogLevel::Trace, "Initializing transport.");
@@ -306,219 +1620,792 @@ UDPSender Sender::Impl::initialize_sender(const std::string& send_address_list,
     logger.log(LogLevel::Info, "Initializing transport, send list: [%s].", parsed_list.c_str());
     logger.log(LogLevel::Config, "Send rate-limit set to %uMB/s.", config.rate_limit_mbs);
 
-    uint64_t startup_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+    return addresses;
+}
+
+std::vector<Destination> Sender::Transport::create_destinations(const Config& config)
+{
+    std::vector<Destination> result;
+    for (auto& config_destination : config.destinations) {
+        Destination destination(config, config_destination);
+
+        std::string parsed_list;
+        for (auto &address : destination.addresses) {
+            if (!parsed_list.empty()) {
+                parsed_list += ", ";
+            }
+            parsed_list += to_string(address);
+        }
+        logger.log(LogLevel::Info, "Destination '%s': %u channel(s), send list: [%s].",
+                    destination.name.c_str(), destination.channel_count, parsed_list.c_str());
+
+        result.push_back(std::move(destination));
+    }
+    return result;
+}
+
+std::vector<std::vector<Serializer::value_type>> Sender::Transport::preset_headers(const Config& config) const
+{
+    static_assert(MAX_MESSAGE_SIZE % SubmessageHeader::alignment == 0, "unaligned message size");
+
+    // Inserted at start of every send buffer, one per shard (stream) and destination.
+    std::vector<std::vector<Serializer::value_type>> headers;
+    for (std::size_t d = 0; d <= destinations.size(); d++) {
+        uint64_t hash = d ? destinations[d - 1].hash : config.hash;
+        for (std::size_t i = 0; i < shard_count; i++) {
+            std::vector<Serializer::value_type> header(Header::size);
+            Serializer s(header);
+            s << Header(startup_time, hash, uint8_t(i));
+            headers.push_back(std::move(header));
+        }
+    }
+    return headers;
+}
+
+std::vector<std::vector<osiSockAddr>> Sender::Transport::lane_addresses() const
+{
+    std::vector<std::vector<osiSockAddr>> result(shard_count, addresses);
+    for (auto& destination : destinations) {
+        result.insert(result.end(), shard_count, destination.addresses);
+    }
+    return result;
+}
+
+void Sender::Transport::complete_timestamp(uint8_t* packet, std::size_t offset, std::chrono::microseconds delay)
+{
+    // called from the transmit thread, delay includes queueing to the thread and rate-limiting
+    Serializer ts(packet + offset, TimestampMessage::size);
+    TimestampMessage timestamp_msg;
+    ts >> timestamp_msg;
+
+    timestamp_msg.send_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
         std::chrono::system_clock::now().time_since_epoch()).count();
+    timestamp_msg.pacing_delay = uint32_t(std::min<int64_t>(delay.count(), std::numeric_limits<uint32_t>::max()));
+
+    ts.position(packet + offset);
+    ts << timestamp_msg;
+}
 
-    // Insert header at start.
-    Serializer s(send_buffer);
-    s << Header(startup_time, config.hash);
+void Sender::Impl::commit(std::size_t length, std::size_t prepare_offset)
+{
+    // destination messages are derived before the message is handed over to the transmit thread
+    if (!destination_streams.empty()) {
+        auto& packet = transmitter.buffer(lane);
+        for (auto& stream : destination_streams) {
+            std::size_t stream_prepare_offset = prepare_offset;
+            auto& stream_packet = transmitter.buffer(stream.lane);
+            std::size_t stream_length = stream.rewrite(packet.data(), length, stream_packet.data(), stream_prepare_offset);
+            if (stream_length) {
+                transmitter.commit(stream.lane, stream_length, stream_prepare_offset);
+            }
+        }
+    }
 
-    return UDPSender(std::move(addresses), config.rate_limit_mbs);
+    transmitter.commit(lane, length, prepare_offset);
 }
 
-void Sender::Impl::send_fragmented_update(Channel* ch)
+void Sender::Impl::send_beacon()
 {
-    auto fragment = ch->value.data();
-    uint16_t all_frags_seq_no = seq_no++;
-    uint16_t frag_seq_no = 0;
-    std::size_t remaining_frag_size = ch->value.size();
+    Serializer s(transmitter.buffer(lane));
+    s += Header::size; // skip preset header
 
-    logger.log(LogLevel::Debug, "Sending fragmented data for channel '%s' (%zu bytes).",
-                ca_name(ch->channel_id), remaining_frag_size);
+    s << SubmessageHeader(
+            SubmessageType::BEACON_MESSAGE,
+            SubmessageFlag::LittleEndian,
+            0);
+    write_beacon(s);
 
-    while (remaining_frag_size) {
+    commit(s.distance());
+}
 
-        Serializer s(send_buffer);
-        s += Header::size; // skip preset header
+void Sender::Impl::write_beacon(Serializer& s)
+{
+    // report last used seq_no, receiver can detect lost messages
+    s << BeaconMessage(uint16_t(seq_no - 1), uint32_t(update_queue.size()), startup_time);
+    s.pad_align(SubmessageHeader::alignment, 0);
+    beacon_pending = false;
 
-        // we must always fit headers in the buffer
-        s.ensure(SubmessageHeader::size + CAFragDataMessage::size);
+    logger.log(LogLevel::Trace, "Sending beacon (queue depth %zu).", update_queue.size());
+}
 
-        s << SubmessageHeader(
-                SubmessageType::CA_FRAG_DATA_MESSAGE,
-                SubmessageFlag::LittleEndian,
-                0);
+void Sender::Impl::start_fragmented_transfer(Channel* ch)
+{
+    // one transfer per channel at a time, the latest value is re-sent once the transfer completes
+    if (ch->in_transfer) {
+        ch->fragment_pending = true;
+        return;
+    }
 
+    ch->in_transfer = true;
+    transfers.push_back(FragmentedTransfer(ch->index));
+}
 
-        // buffer size is limited and always fits uint16_t
-        auto frag_size = (uint16_t)std::min(
-            remaining_frag_size, 
-            s.remaining() - CAFragDataMessage::size);
+bool Sender::Impl::send_next_fragment()
+{
+    if (transfers.empty()) {
+        return false;
+    }
 
-        s << CAFragDataMessage(
-                all_frags_seq_no,
-                frag_seq_no++,
-                ch->index, ch->count, ch->type,
-                frag_size);
+    // round-robin over active transfers
+    transfer_cursor %= std::min(transfers.size(), MAX_ACTIVE_TRANSFERS);
+    auto& transfer = transfers[transfer_cursor];
+    Channel* ch = &channels[transfer.channel_index];
+
+    // snapshot of the value, the channel value can change while the transfer is in progress
+    if (!transfer.started) {
+        // no longer large (e.g. disconnected), send as a regular update
+        if (!needs_fragmentation(ChannelGroup(*ch, channels))) {
+            transfers.erase(transfers.begin() + transfer_cursor);
+            ch->in_transfer = false;
+            ch->fragment_pending = false;
+            ch->mark_update();
+            return true;
+        }
 
-        s.write(fragment, frag_size);
-        s.pad_align(SubmessageHeader::alignment, 0);
+        transfer.started = true;
+        if (!transfer_buffers.empty()) {
+            transfer.value.swap(transfer_buffers.back());
+            transfer_buffers.pop_back();
+        }
+        transfer.value.assign(ch->value.begin(), ch->value.end());
+        transfer.count = uint32_t(ch->count);
+        transfer.wire_type = ch->wire_type;
+        transfer.seq_no = seq_no++;
+        ch->mark_sent(transfer.seq_no);
+
+        logger.log(LogLevel::Debug, "Sending fragmented data for channel '%s' (%zu bytes).",
+                    ca_name(ch->channel_id), transfer.value.size());
+    }
 
-        fragment += frag_size;
-        remaining_frag_size -= frag_size;
+    Serializer s(transmitter.buffer(lane));
+    s += Header::size; // skip preset header
 
-        logger.log(LogLevel::Trace, "Sending fragment %u (%zu bytes remaining).",
-                    (frag_seq_no - 1), remaining_frag_size);
+    s << SubmessageHeader(
+            SubmessageType::CA_FRAG_DATA_MESSAGE,
+            SubmessageFlag::LittleEndian,
+            0);
+    write_fragment(s);
+    fragment_budget -= int64_t(Header::size);
 
-        sender.send(s.data(), s.distance());
+    commit(s.distance());
+    return true;
+}
+
+// Writes the next fragment of the transfer at the cursor (after its submessage header), advances the cursor.
+void Sender::Impl::write_fragment(Serializer& s)
+{
+    auto& transfer = transfers[transfer_cursor];
+    Channel* ch = &channels[transfer.channel_index];
+    auto start_pos = s.position();
+
+    // fixed fragment size, the receiver places fragments at fragment_seq_no * max_fragment_size
+    auto frag_size = (uint16_t)std::min(
+        transfer.value.size() - transfer.offset,
+        CAFragDataMessage::max_fragment_size);
+
+    s << CAFragDataMessage(
+            transfer.seq_no,
+            transfer.fragment_seq_no++,
+            wire_id(*ch), transfer.count, transfer.wire_type,
+            frag_size);
+
+    s.write(transfer.value.data() + transfer.offset, frag_size);
+    s.pad_align(SubmessageHeader::alignment, 0);
+
+    transfer.offset += frag_size;
+    fragment_budget -= int64_t(SubmessageHeader::size + (s.position() - start_pos));
+
+    logger.log(LogLevel::Trace, "Sending fragment %u (%zu bytes remaining).",
+                (transfer.fragment_seq_no - 1), transfer.value.size() - transfer.offset);
+
+    if (transfer.offset < transfer.value.size()) {
+        transfer_cursor++;
+    } else {
+        // completed, cursor now points to the next transfer
+        transfer_buffers.push_back(std::move(transfer.value));
+        transfers.erase(transfers.begin() + transfer_cursor);
+
+        ch->in_transfer = false;
+        if (ch->fragment_pending) {
+            ch->fragment_pending = false;
+            ch->mark_update();
+        }
     }
 }
 
-void Sender::Impl::send_fragmented_updates()
+// Size of the last fragment (submessage) of the transfer at the cursor, 0 if it is not the last one.
+std::size_t Sender::Impl::fragment_tail_size()
 {
-    Channel* ch;
-    while ((ch = next_channel_update())) {
+    if (transfers.empty() || fragment_budget <= 0) {
+        return 0;
+    }
+
+    transfer_cursor %= std::min(transfers.size(), MAX_ACTIVE_TRANSFERS);
+    auto& transfer = transfers[transfer_cursor];
+
+    // fragments are placed at fixed offsets, only a tail can be smaller than max_fragment_size
+    std::size_t remaining = transfer.value.size() - transfer.offset;
+    if (!transfer.started || transfer.fragment_seq_no == 0 || remaining > CAFragDataMessage::max_fragment_size) {
+        return 0;
+    }
+
+    constexpr std::size_t alignment = SubmessageHeader::alignment;
+    return (SubmessageHeader::size + CAFragDataMessage::size + remaining + alignment - 1) & ~(alignment - 1);
+}
 
-        // no need for fragmentation
-        if (ch->value.size() <= CAChannelData::max_data_size) {
+void Sender::Impl::send_fragments(bool interleaved)
+{
+    // within bandwidth share only, one fragment per regular message when interleaved
+    while (fragment_budget > 0 && send_next_fragment()) {
+        if (interleaved) {
             break;
         }
+    }
+}
 
-        send_fragmented_update(ch);
-        ch->clear_update();
+bool Sender::Impl::prepare_delta(const Channel& ch)
+{
+    // keyframe needed
+    const DeltaState& delta = *ch.delta;
+    if (!ch.generation_valid || delta.deltas_since_keyframe >= delta.keyframe_interval ||
+        ch.count != delta.sent_count || ch.wire_type != delta.sent_wire_type ||
+        ch.value.size() != delta.sent_value.size()) {
+        return false;
     }
+
+    constexpr std::size_t BLOCK_SIZE = 256;     // blocks compared by (vectorized) memcmp, then by words
+    constexpr std::size_t WORD_SIZE = 8;
+    constexpr std::size_t MERGE_GAP = 2 * CADeltaRange::size;
+    constexpr std::size_t MAX_DELTA_SIZE =
+        MAX_MESSAGE_SIZE - Header::size - SubmessageHeader::size - CADeltaDataMessage::size;
+
+    // not worth it if more than half of the value changed
+    const std::size_t max_delta_size = std::min(ch.value.size() / 2, MAX_DELTA_SIZE);
+
+    const uint8_t* value = ch.value.data();
+    const uint8_t* sent_value = delta.sent_value.data();
+    const std::size_t size = ch.value.size();
+
+    delta_ranges.clear();
+    std::size_t delta_size = 0;    // upper bound, including padding
+
+    for (std::size_t block = 0; block < size; block += BLOCK_SIZE) {
+        std::size_t block_end = std::min(block + BLOCK_SIZE, size);
+        if (memcmp(value + block, sent_value + block, block_end - block) == 0) {
+            continue;
+        }
+
+        for (std::size_t word = block; word < block_end; word += WORD_SIZE) {
+            std::size_t word_end = std::min(word + WORD_SIZE, size);
+            if (memcmp(value + word, sent_value + word, word_end - word) == 0) {
+                continue;
+            }
+
+            // extend the last range if the gap is cheaper to send than a new range
+            if (!delta_ranges.empty() &&
+                word <= delta_ranges.back().offset + delta_ranges.back().size_bytes + MERGE_GAP) {
+                auto& last = delta_ranges.back();
+                delta_size += word_end - (last.offset + last.size_bytes);
+                last.size_bytes = uint32_t(word_end - last.offset);
+            } else {
+                delta_size += CADeltaRange::size + (word_end - word) + WORD_SIZE;
+                delta_ranges.push_back(CADeltaRange(uint32_t(word), uint32_t(word_end - word)));
+            }
+        }
+
+        if (delta_size > max_delta_size) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
+void Sender::Impl::send_delta_update(Channel* ch)
+{
+    Serializer s(transmitter.buffer(lane));
+    s += Header::size; // skip preset header
+
+    s << SubmessageHeader(
+            SubmessageType::CA_DELTA_DATA_MESSAGE,
+            SubmessageFlag::LittleEndian,
+            0);
+
+    uint16_t delta_seq_no = seq_no++;
+    s << CADeltaDataMessage(
+            delta_seq_no, ch->generation,
+            wire_id(*ch), ch->count, ch->wire_type,
+            uint16_t(delta_ranges.size()));
+
+    std::size_t delta_bytes = 0;
+    for (auto& range : delta_ranges) {
+        s << range;
+        s.write(ch->value.data() + range.offset, range.size_bytes);
+        s.pad_align(SubmessageHeader::alignment, 0);
+
+        // receiver copy
+        memcpy(ch->delta->sent_value.data() + range.offset, ch->value.data() + range.offset, range.size_bytes);
+        delta_bytes += range.size_bytes;
+    }
+
+    ch->generation = delta_seq_no;
+    ch->delta->deltas_since_keyframe++;
+
+    logger.log(LogLevel::Debug, "Sending delta for channel '%s' (%zu range(s), %zu of %zu bytes).",
+                ca_name(ch->channel_id), delta_ranges.size(), delta_bytes, ch->value.size());
+
+    commit(s.distance());
+    clear_update(ch, s.distance() - Header::size);
+}
 
 void Sender::Impl::send_updates()
 {
+    // telemetry is appended after data submessage, reserve space for it
+    const std::size_t telemetry_size = latency_telemetry ? (SubmessageHeader::size + TimestampMessage::size) : 0;
+    const std::size_t telemetry_channel_size = latency_telemetry ? ChannelAge::size : 0;
+
     while (has_updates()) {
 
-        Serializer s(send_buffer);
+        Serializer s(transmitter.buffer(lane));
         s += Header::size; // skip preset header
     
         // we must always fit headers in the buffer
         s.ensure(SubmessageHeader::size + CADataMessage::size);
 
+        auto subheader_pos = s.position();
         s << SubmessageHeader(
                 SubmessageType::CA_DATA_MESSAGE,
                 SubmessageFlag::LittleEndian,
                 0);
 
         bool process_fragmented = false;
+        bool process_delta = false;
 
         uint16_t update_count = 0;
-        s << CADataMessage(seq_no++, update_count);
+        uint16_t message_seq_no = seq_no++;
+        s << CADataMessage(message_seq_no, update_count);
         auto update_count_pos = s.position() - sizeof(update_count);
 
+        message_channels.clear();
+        message_refreshes.clear();
+
+        // size of submessages appended after data submessage
+        auto trailer_size = [&](std::size_t updates, std::size_t refreshes) {
+            return telemetry_size + telemetry_channel_size * updates +
+                ((refreshes > 0) ? (SubmessageHeader::size + CARefreshMessage::size + CAChannelRefresh::size * refreshes) : 0);
+        };
+
+        // unlike ensure(), a failed check does not prevent smaller submessages from being appended
+        auto fits = [&](std::size_t size) {
+            return size <= s.remaining();
+        };
+
+        auto write_group = [&](const Channel* ch, const ChannelGroup& cg) {
+            for (auto i = cg.start_index; i < cg.end_index+1; i++) {
+                Channel &cc = channels[i];
+                s << CAChannelData(wire_id(cc), cc.count, cc.wire_type);
+                s.write(cc.value.data(), cc.value.size());
+                s.pad_align(SubmessageHeader::alignment, 0);
+                update_count++;
+                cc.mark_sent(message_seq_no);
+                // only fresh values, not heartbeats (re-sent values)
+                if (latency_telemetry && cc.event_time >= ch->queue_time) {
+                    message_channels.push_back(cc.index);
+                }
+            }
+        };
+
         Channel* ch;
         while ((ch = next_channel_update())) {
             ChannelGroup cg(*ch, channels);
 
-            if (cg.value_size() > CAChannelData::max_data_size) {
+            // heartbeat of an unchanged value, send only its generation and hash
+            if (!ch->pending_update && lightweight_refresh(cg)) {
+                if (fits(trailer_size(update_count, message_refreshes.size() + cg.count()))) {
+                    for (auto i = cg.start_index; i < cg.end_index+1; i++) {
+                        Channel &cc = channels[i];
+                        message_refreshes.push_back(CAChannelRefresh(wire_id(cc), cc.generation,
+                                                    value_hash(cc.value.data(), cc.value.size())));
+                    }
+                    clear_update(ch, CAChannelRefresh::size * cg.count());
+                    continue;
+                } else {
+                    break;
+                }
+            }
+
+            // partial update of an array, sent in a separate message
+            if (ch->pending_update && ch->delta && !ch->in_transfer && cg.count() == 1 && prepare_delta(*ch)) {
+                process_delta = true;
+                break;
+            }
+
+            if (needs_fragmentation(cg)) {
                 process_fragmented = true;
                 break;
             }
 
             // since total buffer size is multiple of required alignment, 
-            // there is no need to add padding to ensure call
-            if (s.ensure(cg.value_size_aligned(SubmessageHeader::alignment))) {
-                for (auto i = cg.start_index; i < cg.end_index+1; i++) {
-                    Channel &cc = channels[i];
-                    s << CAChannelData(cc.index, cc.count, cc.type);
-                    s.write(cc.value.data(), cc.value.size());
-                    s.pad_align(SubmessageHeader::alignment, 0);
-                    update_count++;
-                }
-                ch->clear_update();
+            // there is no need to add padding to the size check
+            if (fits(cg.value_size_aligned() +
+                     trailer_size(update_count + cg.count(), message_refreshes.size()))) {
+                write_group(ch, cg);
+                clear_update(ch, cg.value_size_aligned());
             } else {
                 break;
             }
         }
 
-        // Update update_count.
-        std::size_t bytes_to_send = s.distance();
-        s.position(update_count_pos);
-        s << update_count;
+        // the next update does not fit (or is sent separately), fill the message with smaller updates
+        // queued behind it (same class, within the reordering window), their queue entries become stale
+        if (ch && ch->pending_update && reorder_window) {
+            const Priority priority = update_queue.selected_priority();
+            const auto& queue = update_queue.queue(std::size_t(priority));
+            const std::size_t window = std::min(queue.size(), reorder_window + 1);
+            for (std::size_t i = 1; i < window; i++) {
+                Channel* candidate = &channels[queue[i]];
+                // delta updates are sent in separate messages
+                if (!candidate->pending_update || candidate->queued_priority != priority || candidate->delta) {
+                    continue;
+                }
+
+                ChannelGroup cg(*candidate, channels);
+                if (!needs_fragmentation(cg) &&
+                    fits(cg.value_size_aligned() +
+                         trailer_size(update_count + cg.count(), message_refreshes.size()))) {
+                    write_group(candidate, cg);
+                    candidate->clear_update(cg.value_size_aligned(), false);
+                }
+            }
+        }
+
+        // nothing but a fragmented or delta update to be sent, do not waste a message
+        if (update_count == 0 && message_refreshes.empty() && (process_fragmented || process_delta)) {
+            seq_no = message_seq_no;
+        } else {
+            // submessages are appended after data submessage, each preceding one gets its explicit size
+            Serializer::value_type* last_subheader_pos = subheader_pos;
+            uint8_t last_id = SubmessageType::CA_DATA_MESSAGE;
+            auto append_submessage = [&](uint8_t id) {
+                auto pos = s.position();
+                s.position(last_subheader_pos);
+                s << SubmessageHeader(
+                        last_id,
+                        SubmessageFlag::LittleEndian,
+                        uint16_t(pos - last_subheader_pos - SubmessageHeader::size));
+                s.position(pos);
+
+                last_subheader_pos = pos;
+                last_id = id;
+                s << SubmessageHeader(
+                        id,
+                        SubmessageFlag::LittleEndian,
+                        0);
+            };
+
+            if (!message_refreshes.empty()) {
+                append_submessage(SubmessageType::CA_REFRESH_MESSAGE);
+                s << CARefreshMessage(uint16_t(message_refreshes.size()));
+                for (auto& refresh : message_refreshes) {
+                    s << refresh;
+                }
+                s.pad_align(SubmessageHeader::alignment, 0);
+            }
+
+            Serializer::value_type* timestamp_pos = nullptr;
+            if (latency_telemetry) {
+                append_submessage(SubmessageType::TIMESTAMP_MESSAGE);
+
+                // send time and pacing delay are set by the transmit thread, see complete_timestamp()
+                timestamp_pos = s.position();
+                s << TimestampMessage(uint16_t(message_channels.size()));
+
+                auto now = std::chrono::steady_clock::now();
+                for (auto index : message_channels) {
+                    auto age = std::chrono::duration_cast<std::chrono::microseconds>(now - channels[index].event_time).count();
+                    s << ChannelAge(index + channel_offset, uint32_t(std::min<int64_t>(age, std::numeric_limits<uint32_t>::max())));
+                }
+                s.pad_align(SubmessageHeader::alignment, 0);
+            }
+
+            // tail of a fragmented transfer, if it fits in the remaining space
+            std::size_t tail_size = fragment_tail_size();
+            if (tail_size && fits(tail_size)) {
+                append_submessage(SubmessageType::CA_FRAG_DATA_MESSAGE);
+                write_fragment(s);
+            }
+
+            // beacon of the period in the last message, reports its seq_no
+            if (beacon_pending && !ch && fits(SubmessageHeader::size + BeaconMessage::size)) {
+                append_submessage(SubmessageType::BEACON_MESSAGE);
+                write_beacon(s);
+            }
+
+            // Update update_count.
+            std::size_t bytes_to_send = s.distance();
+            s.position(update_count_pos);
+            s << update_count;
 
-        logger.log(LogLevel::Debug, "Sending %u update(s).", update_count);
+            logger.log(LogLevel::Debug, "Sending %u update(s), %zu refresh(es).", update_count, message_refreshes.size());
 
-        sender.send(s.data(), bytes_to_send);
+            commit(bytes_to_send, timestamp_pos ? std::size_t(timestamp_pos - s.data()) : 0);
+        }
 
         if (process_fragmented) {
-            send_fragmented_updates();
+            start_fragmented_transfer(ch);
+            clear_update(ch, ch->value.size());
+        } else if (process_delta) {
+            send_delta_update(ch);
+        }
+
+        send_fragments(true);
+    }
+
+    send_fragments(false);
+}
+
+// Whether the group does not fit in an empty data message, including the latency telemetry reserved for it.
+bool Sender::Impl::needs_fragmentation(const ChannelGroup& cg) const
+{
+    constexpr std::size_t capacity = MAX_MESSAGE_SIZE - Header::size - SubmessageHeader::size - CADataMessage::size;
+    const std::size_t telemetry_size = latency_telemetry ?
+        (SubmessageHeader::size + TimestampMessage::size + ChannelAge::size * cg.count()) : 0;
+
+    return cg.value_size() > CAChannelData::max_data_size ||
+           cg.value_size_aligned() + telemetry_size > capacity;
+}
+
+bool Sender::Impl::lightweight_refresh(const ChannelGroup& cg) const
+{
+    if (!full_refresh_cycles) {
+        return false;
+    }
+
+    // rolling schedule, only a part of the channels is fully re-sent in each cycle
+    if ((carousel_cycle + cg.start_index) % full_refresh_cycles == 0) {
+        return false;
+    }
+
+    // not worth it for small values
+    if (cg.value_size_aligned() <= CAChannelRefresh::size * cg.count()) {
+        return false;
+    }
+
+    for (auto i = cg.start_index; i < cg.end_index+1; i++) {
+        if (!channels[i].generation_valid) {
+            return false;
         }
     }
+    return true;
 }
 
 
-void Sender::Impl::mark_heartbeat_updates()
+// Advances the timing wheel by an update period, queues the deferred updates that are due.
+void Sender::Impl::release_deferred_updates()
 {
-    logger.log(LogLevel::Debug, "Heartbeat check.");
+    auto& due_channels = timing_wheel.advance();
+    for (auto index : due_channels) {
+        channels[index].release_deferred_update(timing_wheel.current_tick());
+    }
+    due_channels.clear();
+}
 
-    std::size_t n_connected = 0;
-    std::size_t n_marked = 0;
-    for (auto& channel : channels) {
-        bool marked = channel.mark_heartbeat_update();
+void Sender::Impl::advance_heartbeat_carousel()
+{
+    // unused budget is not carried over (no bursts), overdraft is
+    refresh_budget = std::min(refresh_budget, int64_t(0)) + refresh_budget_per_period;
+
+    auto now = std::chrono::steady_clock::now();
+    for (std::size_t n = 0; n < carousel_slice; n++) {
+        auto& channel = channels[carousel_position];
 
         if (channel.status != ECA_DISCONN) {
-            n_connected++;
+            carousel_connected++;
         }
-        if (marked) {
-            n_marked++;
+
+        if (channel.is_channel() && channel.check_heartbeat() &&
+            !channel.pending_update && !channel.pending_refresh) {
+            channel.pending_refresh = true;
+            channel.queue_time = now;
+            refresh_deque.push_back(channel.index);
+            carousel_refreshed++;
         }
 
+        if (++carousel_position == channels.size()) {
+            carousel_position = 0;
+            report_heartbeat_cycle();
+        }
     }
+}
 
-    std::size_t percent_connected = (100 * n_connected / channels.size());
-    std::size_t percent_stalled = (100 * n_marked / channels.size());
+void Sender::Impl::report_heartbeat_cycle()
+{
+    logger.log(LogLevel::Debug, "Heartbeat cycle completed.");
+
+    std::size_t percent_connected = (100 * carousel_connected / channels.size());
+    std::size_t percent_stalled = (100 * carousel_refreshed / channels.size());
     logger.log(LogLevel::Config, "%zu of %zu (%u%%) connected, %zu (%u%%) without updates in the last heartbeat period.", 
-        n_connected, channels.size(), percent_connected,
-        n_marked, percent_stalled);
+        carousel_connected, channels.size(), percent_connected,
+        carousel_refreshed, percent_stalled);
+
+    // more than one slice pending means refreshes are not keeping up
+    if (refresh_deque.size() > carousel_slice) {
+        logger.log(LogLevel::Warning, "%zu heartbeat update(s) pending, heartbeat bandwidth share too small.",
+            refresh_deque.size());
+    }
 
+    carousel_connected = 0;
+    carousel_refreshed = 0;
+    carousel_cycle++;
 }
 
 namespace {
 
 Logger logger("sender.ca");
 
-void event_handler(evargs args)
+// CA protocol minor version supporting dynamic array sizes (V4.13).
+constexpr unsigned CA_MINOR_PROTOCOL_DYNAMIC_ARRAYS = 13;
+
+// Hash of a DBR value ignoring its timestamp, status and severity are included.
+uint64_t dbr_value_hash(long type, const void* dbr, uint32_t size)
 {
-    auto* ch = static_cast<Channel*>(args.usr);
+    if (!dbr_type_is_TIME(type)) {
+        return value_hash(dbr, size);
+    }
 
+    constexpr uint32_t stamp_offset = offsetof(dbr_time_string, stamp);
+    constexpr uint32_t value_offset = stamp_offset + sizeof(epicsTimeStamp);
+
+    auto bytes = static_cast<const uint8_t*>(dbr);
+    uint64_t hash = value_hash(bytes, stamp_offset);
+    return hash ^ (value_hash(bytes + value_offset, size - value_offset) * 1099511628211ULL);
+}
+
+void process_event(Channel* ch, int event_status, long event_type, long event_count, const void* event_dbr)
+{
     if (logger.is_loggable(LogLevel::Debug)) {
         logger.log(LogLevel::Debug, "Channel '%s' [%u] event received, status: %d.",
                     ca_name(ch->channel_id), ch->index, ch->status);
     }
 
-    ch->status = args.status;
-    if (args.status == ECA_NORMAL)
+    ch->status = event_status;
+    if (event_status == ECA_NORMAL)
     {
-        ch->count = args.count;
+        const void* dbr = event_dbr;
+        long count = event_count;
+        long type = event_type;
+
+        // alarm transitions are promoted to high priority
+        bool severity_changed = false;
+        if (dbr_type_is_TIME(type)) {
+            auto severity = static_cast<const dbr_time_short*>(dbr)->severity;
+            severity_changed = ch->severity_valid && ch->severity != severity;
+            ch->severity_valid = true;
+            ch->severity = severity;
+        }
+
+        bool within_deadband = false;
+        uint16_t wire_type = uint16_t(type);
+        if (auto* processing = ch->processing.get()) {
+            // region of interest, downsampling
+            if (processing->array_transform.enabled()) {
+                count = processing->array_transform.apply(type, dbr, count, processing->transform_buffer);
+                dbr = processing->transform_buffer.data();
+            }
 
-        unsigned size_to_copy = dbr_size_n(args.type, ch->count);
-        bool size_changed = ch->value.size() != size_to_copy;
+            // deadband is applied to the original (not encoded) values
+            within_deadband = processing->deadband.enabled() && !processing->deadband.check(type, dbr, count);
 
-        ch->value.resize(size_to_copy);
-        memcpy(ch->value.data(), args.dbr, size_to_copy);
+            // precision narrowing
+            if (processing->encoding.enabled() && type == DBR_TIME_DOUBLE) {
+                type = processing->encoding.encode(dbr, count, processing->encode_buffer);
+                dbr = processing->encode_buffer.data();
+                wire_type = uint16_t(type) | ENCODED_TYPE_FLAG;
+            }
+        }
 
-        if (ch->is_polled) {
-            auto hash = value_hash(ch->value.data(), size_to_copy);
+        unsigned size_to_copy = dbr_size_n(type, count);
+        bool size_changed = ch->value.size() != size_to_copy || ch->wire_type != wire_type;
 
-            if (ch->value_hash_initialized == false || size_changed || ch->value_hash != hash) {
-                ch->value_hash_initialized = true;
-                ch->value_hash = hash;
-                ch->mark_update();
+        // change detection, polled fields always
+        if (ch->is_polled || ch->dedup != DedupMode::none) {
+            auto hash = (ch->dedup == DedupMode::value) ?
+                dbr_value_hash(type, dbr, size_to_copy) :
+                value_hash(dbr, size_to_copy);
+
+            if (ch->value_hash_initialized && !size_changed && ch->value_hash == hash) {
+                // duplicate, keep (and re-send with heartbeat) the last sent value
+                return;
+            }
+            ch->value_hash_initialized = true;
+            ch->value_hash = hash;
+        }
+
+        bool to_send = !within_deadband || size_changed;
+
+        ch->count = count;
+        ch->wire_type = wire_type;
+        ch->value.resize(size_to_copy);
+        memcpy(ch->value.data(), dbr, size_to_copy);
+
+        if (to_send) {
+            if (severity_changed) {
+                ch->promoted = true;
             }
-        } else {
             ch->mark_update();
+        } else {
+            // within deadband, (latest) value is re-sent in full with heartbeat
+            ch->generation_valid = false;
         }
+
+        // set after marking update, heartbeats are marked after event (see send_updates)
+        ch->event_time = std::chrono::steady_clock::now();
     }
 }
 
-void connection_handler(connection_handler_args args)
+void event_handler(evargs args);
+
+// Sets DBR type of the channel native type, returns the subscription event mask.
+long set_dbr_type(Channel* ch)
 {
-    auto* ch = static_cast<Channel*>(ca_puser(args.chid));
-    if (args.op == CA_OP_CONN_UP) {
+    // value only for fields, otherwise DBR_TIME_* for default fields
+    long mask;
+    if (ch->is_value_only) {
+        ch->type = ch->channel_type;
+        mask = DBE_VALUE;
+    }
+    else {
+        ch->type = dbf_type_to_DBR_TIME(ch->channel_type);
+        mask = DBE_VALUE | DBE_ALARM;
+    }
+    if (ch->event_mask) {
+        mask = ch->event_mask;
+    }
+    return mask;
+}
+
+// Type and count are those at the time of the connection, a queued connection may be processed
+// after the channel has disconnected again (its disconnection is queued behind it).
+void process_connection(Channel* ch, long op, chtype new_type, long new_count)
+{
+    if (op == CA_OP_CONN_UP) {
+
+        if (new_type == TYPENOTCONN) {
+            return;
+        }
 
         logger.log(LogLevel::Debug, "Channel '%s' [%u] connected.",
                     ca_name(ch->channel_id), ch->index);
 
-        chtype new_type = ca_field_type(ch->channel_id);
-        long new_count = ca_element_count(ch->channel_id);
+        // count 0 subscribes for the valid elements only (dynamic array size)
+        long subscription_count = new_count;
+        if (ch->variable_length && new_count > 1 &&
+            ca_host_minor_protocol(ch->channel_id) >= CA_MINOR_PROTOCOL_DYNAMIC_ARRAYS) {
+            subscription_count = 0;
+        }
 
-        // Re-subscribe on new type.
-        if (ch->event_id && ch->channel_type != new_type) {
+        // Re-subscribe on new type (or count, subscribed before connection with a cached type and count).
+        if (ch->event_id && (ch->channel_type != new_type || ch->subscribed_count != subscription_count)) {
             if (!ch->is_polled) {
                 ca_clear_subscription(ch->event_id);
             }
@@ -526,19 +2413,10 @@ void connection_handler(connection_handler_args args)
         }
 
         ch->channel_type = new_type;
+        ch->element_count = new_count;
+        long mask = set_dbr_type(ch);
 
-        // value only for fields, otherwise DBR_TIME_* for default fields
-        long mask;
-        if (strchr(ca_name(ch->channel_id), '.')) {
-            ch->type = ch->channel_type;
-            mask = DBE_VALUE;
-        }
-        else {
-            ch->type = dbf_type_to_DBR_TIME(ch->channel_type);
-            mask = DBE_VALUE | DBE_ALARM;
-        }
-
-        // Re-allocate, if needed.
+        // Re-allocate, if needed (for the maximum count, events of variable length arrays do not re-allocate).
         auto new_dbr_size = (std::size_t)dbr_size_n(ch->type, new_count);
         if (ch->value.capacity() < new_dbr_size) {
             ch->value.reserve(new_dbr_size);
@@ -547,18 +2425,24 @@ void connection_handler(connection_handler_args args)
         if (!ch->is_polled) {
             if (!ch->event_id) {
                 ch->status = ca_create_subscription(ch->type,
-                                                     new_count,
+                                                     subscription_count,
                                                      ch->channel_id,
                                                      mask,
                                                      event_handler,
                                                      (void*)ch,
                                                      &ch->event_id);
+                ch->subscribed_count = subscription_count;
+            } else {
+                ch->status = ECA_NORMAL;
             }
         } else {
             ch->status = ECA_NORMAL;
+            // poll at the fast rate after (re-)connect
+            ch->poll_interval = 1;
+            ch->poll_countdown = 1;
         }
     }
-    else if (args.op == CA_OP_CONN_DOWN) {
+    else if (op == CA_OP_CONN_DOWN) {
         logger.log(LogLevel::Debug, "Channel '%s' [%u] disconnected.",
                     ca_name(ch->channel_id), ch->index);
 
@@ -566,21 +2450,207 @@ void connection_handler(connection_handler_args args)
         ch->status = ECA_DISCONN;
         ch->count = -1;
         ch->value.resize(0);
+        ch->value_hash_initialized = false;
+        if (ch->processing) {
+            ch->processing->deadband.reset();
+        }
+        ch->severity_valid = false;
+        ch->parent_channel().promoted = true;
         ch->mark_update();
+        ch->event_time = std::chrono::steady_clock::now();
     }
 }
 
+void event_handler(evargs args)
+{
+    auto* ch = static_cast<Channel*>(args.usr);
+
+    // preemptive callbacks, copy the value and hand it over to the sender thread
+    if (auto* event_queue = ch->context.event_queue) {
+        auto* event = event_queue->acquire();
+        event->channel = ch;
+        event->kind = EventQueue::Kind::event;
+        event->status = args.status;
+        event->type = args.type;
+        event->count = args.count;
+        if (args.status == ECA_NORMAL) {
+            auto* dbr = static_cast<const uint8_t*>(args.dbr);
+            event->dbr.assign(dbr, dbr + dbr_size_n(args.type, args.count));
+        }
+        event_queue->push(event);
+        return;
+    }
+
+    process_event(ch, args.status, args.type, args.count, args.dbr);
 }
 
-void Sender::Impl::check_polled_fields()
+void connection_handler(connection_handler_args args)
 {
-    logger.log(LogLevel::Debug, "Polled fields check.");
+    auto* ch = static_cast<Channel*>(ca_puser(args.chid));
 
-    for (auto& channel : channels) {
-        if (channel.is_polled) {
-            ca_array_get_callback(channel.channel_type, (unsigned long) 0, channel.channel_id, event_handler, &channel.index);
+    // preemptive callbacks, subscription is (re-)created by the sender thread
+    if (auto* event_queue = ch->context.event_queue) {
+        if (args.op == CA_OP_CONN_UP || args.op == CA_OP_CONN_DOWN) {
+            auto* event = event_queue->acquire();
+            event->channel = ch;
+            event->kind = (args.op == CA_OP_CONN_UP) ? EventQueue::Kind::connected : EventQueue::Kind::disconnected;
+            event->type = ca_field_type(args.chid);
+            event->count = ca_element_count(args.chid);
+            event_queue->push(event);
+        }
+        return;
+    }
+
+    process_connection(ch, args.op, ca_field_type(args.chid), ca_element_count(args.chid));
+}
+
+}
+
+void Sender::Impl::process_queued_events()
+{
+    bool connected = false;
+    while (auto* event = event_queue->pop()) {
+        switch (event->kind) {
+            case EventQueue::Kind::event:
+                process_event(event->channel, event->status, event->type, event->count, event->dbr.data());
+                break;
+            case EventQueue::Kind::connected:
+                process_connection(event->channel, CA_OP_CONN_UP, chtype(event->type), event->count);
+                connected = true;
+                break;
+            case EventQueue::Kind::disconnected:
+                process_connection(event->channel, CA_OP_CONN_DOWN, chtype(event->type), event->count);
+                break;
+        }
+        event_queue->recycle(event);
+    }
+
+    // issue subscriptions of the connected channels
+    if (connected) {
+        ca_flush_io();
+    }
+}
+
+void Sender::Impl::poll_fields()
+{
+    if (polled_channels.empty()) {
+        return;
+    }
+
+    // gets issued in one of the previous update periods
+    if (poll_batch_size) {
+        if (ca_sg_test(poll_group) == ECA_IOINPROGRESS) {
+            // the next slice waits for the batch to complete
+            if (iteration - poll_batch_iteration < pf_iterations) {
+                return;
+            }
+            logger.log(LogLevel::Debug, "Polled fields get timeout, %zu get(s) dropped.", poll_batch_size);
+            ca_sg_reset(poll_group);
+        } else {
+            complete_poll_batch();
+        }
+        poll_batch_size = 0;
+    }
+
+    for (std::size_t n = 0; n < poll_slice; n++) {
+        auto index = polled_channels[poll_position];
+        poll_position = (poll_position + 1) % polled_channels.size();
+
+        Channel& ch = channels[index];
+        if (--ch.poll_countdown > 0) {
+            continue;
+        }
+        ch.poll_countdown = ch.poll_interval;
+
+        // type and count are set when the connection is processed (queued with preemptive callbacks)
+        if (!ch.channel_id || ch.status != ECA_NORMAL || ch.type == TYPENOTCONN) {
+            continue;
+        }
+
+        if (poll_batch_size == poll_batch.size()) {
+            poll_batch.emplace_back();
+        }
+        auto& get = poll_batch[poll_batch_size];
+        get.index = index;
+        get.type = ch.type;
+        get.count = ch.element_count;
+        get.buffer.resize(dbr_size_n(get.type, get.count));
+
+        int result = ca_sg_array_get(poll_group, get.type, get.count, ch.channel_id, get.buffer.data());
+        if (result == ECA_NORMAL) {
+            poll_batch_size++;
+        } else {
+            logger.log(LogLevel::Debug, "Failed to poll '%s': %s.", ca_name(ch.channel_id), ca_message(result));
+        }
+    }
+
+    if (poll_batch_size) {
+        logger.log(LogLevel::Debug, "Polling %zu field(s).", poll_batch_size);
+        poll_batch_iteration = iteration;
+        ca_flush_io();
+    }
+}
+
+void Sender::Impl::complete_poll_batch()
+{
+    for (std::size_t i = 0; i < poll_batch_size; i++) {
+        auto& get = poll_batch[i];
+        Channel& ch = channels[get.index];
+
+        // disconnected (or re-connected with another type) in the meantime
+        if (ch.status != ECA_NORMAL || ch.type != get.type) {
+            continue;
+        }
+
+        bool hash_valid = ch.value_hash_initialized;
+        auto hash = ch.value_hash;
+        process_event(&ch, ECA_NORMAL, get.type, long(get.count), get.buffer.data());
+        bool changed = !hash_valid || ch.value_hash != hash;
+
+        // back off exponentially while unchanged, fast rate on change
+        ch.poll_interval = changed ? 1 : uint8_t(std::min(ch.poll_interval * 2, int(MAX_POLL_BACKOFF)));
+        ch.poll_countdown = std::min(ch.poll_countdown, ch.poll_interval);
+    }
+}
+
+std::string Sender::Impl::ca_channel_name(const ConfigChannel& config_channel)
+{
+    std::string filters;
+    auto add_filter = [&filters](const std::string& filter) {
+        if (!filters.empty()) {
+            filters += ',';
         }
+        filters += filter;
+    };
+
+    char buffer[64];
+    if (config_channel.ca_dbnd > 0) {
+        snprintf(buffer, sizeof(buffer), "\"dbnd\":{\"abs\":%.17g}", config_channel.ca_dbnd);
+        add_filter(buffer);
+    }
+    if (config_channel.ca_dec > 1) {
+        snprintf(buffer, sizeof(buffer), "\"dec\":{\"n\":%u}", config_channel.ca_dec);
+        add_filter(buffer);
+    }
+
+    // raw filter JSON object, members are merged
+    auto& ca_filter = config_channel.ca_filter;
+    auto first = ca_filter.find('{');
+    auto last = ca_filter.rfind('}');
+    if (first != std::string::npos && last != std::string::npos && last > first + 1) {
+        add_filter(ca_filter.substr(first + 1, last - first - 1));
+    }
+
+    if (filters.empty()) {
+        return config_channel.channel_name;
+    }
+
+    // filters require a field name (EPICS 3.15+ server), e.g. 'rec.VAL{"dec":{"n":4}}'
+    std::string name = config_channel.channel_name;
+    if (name.find('.') == std::string::npos) {
+        name += ".VAL";
     }
+    return name + "{" + filters + "}";
 }
 
 void Sender::Impl::create_channel(
@@ -588,24 +2658,210 @@ void Sender::Impl::create_channel(
             const std::string channel_name,
             uint32_t channel_num,
             uint32_t channel_parent_num,
-            const bool is_polled)
+            const bool is_polled,
+            const ConfigChannel& config_channel)
 {
     logger.log(LogLevel::Debug, "Creating channel: [%d] '%s'.", channel_num, channel_name.c_str());
 
-    // Note: use Channel &channel = emplace_back((uint32_t)n, update_deque) with C++17 
-    channels.push_back(Channel(channel_num, channel_parent_num, is_polled, update_deque, channels));
+    // Note: use Channel &channel = emplace_back((uint32_t)n, channel_context) with C++17 
+    channels.push_back(Channel(channel_num, channel_parent_num, is_polled, channel_context));
     Channel &channel = channels[channel_num];
 
-    int result = ca_create_channel(channel_name.c_str(),
-                                   connection_handler,
-                                   &channel,
-                                   0,
-                                   &channel.channel_id);
-    if (result != ECA_NORMAL) {
-        logger.log(LogLevel::Error, "CA error %s occurred while trying "
-                    "to create channel '%s'.", ca_message(result), channel_name.c_str());
-        channel.status = result;
+    // explicitly configured fields are handled as fields
+    channel.is_value_only = channel.is_field() || (config_channel.channel_name.find('.') != std::string::npos);
+    channel.variable_length = variable_length_arrays;
+
+    // polled fields are always checked for changes
+    if (!is_polled) {
+        channel.dedup = config_channel.dedup;
+    }
+    // deadband, filters and event mask apply to the record (default field) value only
+    std::string filtered_name = channel_name;
+    if (channel.is_channel()) {
+        ArrayTransform array_transform(config_channel);
+        ValueEncoding encoding(config_channel);
+        Deadband deadband(config_channel);
+        if (array_transform.enabled() || encoding.enabled() || deadband.enabled()) {
+            channel.processing.reset(new ValueProcessing());
+            channel.processing->array_transform = array_transform;
+            channel.processing->encoding = encoding;
+            channel.processing->deadband = deadband;
+        }
+        if (config_channel.array_delta && config_channel.keyframe_interval > 0) {
+            channel.delta.reset(new DeltaState());
+            channel.delta->keyframe_interval = config_channel.keyframe_interval;
+        }
+        if (config_channel.min_update_period > update_period) {
+            channel.min_interval_ticks = uint64_t(std::round(config_channel.min_update_period / update_period));
+        }
+        channel.event_mask = config_channel.event_mask;
+        channel.priority = config_channel.priority;
+        filtered_name = ca_channel_name(config_channel);
+        if (filtered_name != channel_name) {
+            logger.log(LogLevel::Config, "Channel '%s' subscribed as '%s'.", channel_name.c_str(), filtered_name.c_str());
+        }
+    }
+
+    // CA channel is created later, in a batch
+    pending_connects.push_back(PendingConnect{channel_num, filtered_name});
+}
+
+void Sender::Impl::connect_channels()
+{
+    if (pending_connects.empty()) {
+        return;
+    }
+
+    auto end = connect_batch_size ?
+        std::min(pending_connects.size(), connect_position + connect_batch_size) :
+        pending_connects.size();
+
+    for (; connect_position < end; connect_position++) {
+        auto& pending = pending_connects[connect_position];
+        Channel& channel = channels[pending.index];
+
+        int result = ca_create_channel(pending.name.c_str(),
+                                       connection_handler,
+                                       &channel,
+                                       0,
+                                       &channel.channel_id);
+        if (result != ECA_NORMAL) {
+            logger.log(LogLevel::Error, "CA error %s occurred while trying "
+                        "to create channel '%s'.", ca_message(result), pending.name.c_str());
+            channel.status = result;
+            continue;
+        }
+
+        auto cached = channel_cache.find(pending.name);
+        if (cached != channel_cache.end()) {
+            subscribe_cached(channel, cached->second.type, cached->second.count);
+        }
+    }
+
+    // send search requests of the batch
+    ca_flush_io();
+
+    if (connect_position == pending_connects.size()) {
+        logger.log(LogLevel::Info, "All %zu CA channels created.", pending_connects.size());
+        std::vector<PendingConnect>().swap(pending_connects);
+        connect_position = 0;
+    } else {
+        logger.log(LogLevel::Debug, "Created %zu of %zu CA channels.", connect_position, pending_connects.size());
+    }
+}
+
+void Sender::Impl::subscribe_cached(Channel& ch, chtype type, long count)
+{
+    // value buffer is pre-sized and the subscription is created before the connection
+    // (re-subscribed on connection if the type or count has changed)
+    ch.channel_type = type;
+    ch.element_count = count;
+    long mask = set_dbr_type(&ch);
+    ch.value.reserve(dbr_size_n(ch.type, count));
+
+    if (!ch.is_polled) {
+        int result = ca_create_subscription(ch.type, count, ch.channel_id, mask,
+                                            event_handler, &ch, &ch.event_id);
+        if (result == ECA_NORMAL) {
+            ch.subscribed_count = count;
+        } else {
+            ch.event_id = NULL;
+        }
+    }
+}
+
+void Sender::Impl::report_connection_progress()
+{
+    if (full_state || iteration % progress_iterations != 0) {
+        return;
+    }
+
+    std::size_t connected = 0;
+    std::size_t received = 0;
+    for (auto& ch : channels) {
+        if (ch.channel_id && ca_state(ch.channel_id) == cs_conn) {
+            connected++;
+            if (ch.count >= 0 && ch.event_time != std::chrono::steady_clock::time_point{}) {
+                received++;
+            }
+        }
+    }
+
+    using secs = std::chrono::duration<double>;
+    double elapsed = secs(std::chrono::steady_clock::now() - startup_clock).count();
+
+    // full state: all channels connected, their values received and sent
+    if (received == channels.size() && update_queue.empty()) {
+        full_state = true;
+        logger.log(LogLevel::Info, "Full state of %zu channel(s) sent %.1fs after startup.", channels.size(), elapsed);
+        if (!channel_cache_file.empty()) {
+            save_channel_cache();
+        }
+        return;
+    }
+
+    // stalled progress is reported less often and at debug level only, as is progress after the startup window
+    bool stalled = (connected == reported_connected && received == reported_received);
+    if (stalled && --progress_countdown > 0) {
+        return;
+    }
+    progress_interval = stalled ? std::min(progress_interval * 2, uint32_t(MAX_PROGRESS_BACKOFF)) : 1;
+    progress_countdown = progress_interval;
+    reported_connected = connected;
+    reported_received = received;
+
+    auto level = (stalled || elapsed > STARTUP_REPORT_WINDOW) ? LogLevel::Debug : LogLevel::Info;
+    logger.log(level, "Startup progress after %.0fs: %zu of %zu channel(s) connected, %zu with value.",
+                elapsed, connected, channels.size(), received);
+}
+
+void Sender::Impl::load_channel_cache()
+{
+    std::ifstream file(channel_cache_file);
+    if (!file) {
+        logger.log(LogLevel::Config, "No channel cache '%s'.", channel_cache_file.c_str());
+        return;
+    }
+
+    // one channel per line: type count name
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream is(line);
+        int type;
+        long count;
+        std::string name;
+        if (is >> type >> count >> std::ws && std::getline(is, name) && !name.empty() &&
+            type >= 0 && type <= LAST_TYPE && count > 0) {
+            channel_cache[name] = CachedChannel{chtype(type), count};
+        }
+    }
+    logger.log(LogLevel::Config, "Loaded %zu channel(s) from channel cache '%s'.",
+                channel_cache.size(), channel_cache_file.c_str());
+}
+
+void Sender::Impl::save_channel_cache()
+{
+    // written to a temporary file first, not to leave a truncated cache
+    std::string tmp_file = channel_cache_file + ".tmp";
+    FILE* file = fopen(tmp_file.c_str(), "w");
+    if (!file) {
+        logger.log(LogLevel::Warning, "Failed to write channel cache '%s': %s.", tmp_file.c_str(), strerror(errno));
+        return;
+    }
+
+    std::size_t saved = 0;
+    for (auto& ch : channels) {
+        if (ch.channel_id && ch.channel_type != TYPENOTCONN && ch.element_count > 0) {
+            fprintf(file, "%d %ld %s\n", int(ch.channel_type), ch.element_count, ca_name(ch.channel_id));
+            saved++;
+        }
+    }
+
+    if (fclose(file) != 0 || rename(tmp_file.c_str(), channel_cache_file.c_str()) != 0) {
+        logger.log(LogLevel::Warning, "Failed to write channel cache '%s': %s.", channel_cache_file.c_str(), strerror(errno));
+        return;
     }
+    logger.log(LogLevel::Debug, "Saved %zu channel(s) to channel cache '%s'.", saved, channel_cache_file.c_str());
 }
 
 
@@ -627,14 +2883,16 @@ std::vector<Channel> Sender::Impl::create_channels(const Config& config)
                        config_channel.channel_name,
                        current_channel_num++,
                        channel_parent_num,
-                       false);
+                       false,
+                       config_channel);
 
         for (auto &field_name : config_channel.extra_fields) {
             create_channel(channels,
                            config_channel.channel_name + "." + field_name,
                            current_channel_num++,
                            channel_parent_num,
-                           false);
+                           false,
+                           config_channel);
         }
 
         for (auto &field_name : config_channel.polled_fields) {
@@ -642,8 +2900,12 @@ std::vector<Channel> Sender::Impl::create_channels(const Config& config)
                            config_channel.channel_name + "." + field_name,
                            current_channel_num++,
                            channel_parent_num,
-                           true);
+                           true,
+                           config_channel);
         }
+
+        // group range is precomputed, no need to scan the fields when packing the group
+        channels[channel_parent_num].group_end_index = current_channel_num - 1;
     }
 
     return channels;
@@ -651,14 +2913,112 @@ std::vector<Channel> Sender::Impl::create_channels(const Config& config)
 
 
 
+namespace {
+
+constexpr std::size_t MAX_SENDER_SHARDS = 64;
+
+// Contiguous partitions of the channels with (about) the same number of CA channels (fields included),
+// channel ids stay the same as with a single sender.
+std::vector<Config> partition_channels(const Config& config, std::vector<uint32_t>& channel_offsets)
+{
+    std::size_t shard_count = std::min(std::size_t(std::max(config.sender_shards, 1u)), MAX_SENDER_SHARDS);
+    shard_count = std::max(std::size_t(1), std::min(shard_count, config.channels.size()));
+
+    // hash of the entire configuration is kept, bandwidth budgets (heartbeats, fragments) are split
+    Config shard_template = config;
+    shard_template.channels.clear();
+    if (config.rate_limit_mbs > 0) {
+        shard_template.rate_limit_mbs = std::max(uint32_t(1), uint32_t(config.rate_limit_mbs / shard_count));
+    }
+
+    std::vector<Config> shards;
+    const std::size_t total = config.total_channel_count();
+    std::size_t assigned = 0;
+    auto it = config.channels.begin();
+    for (std::size_t i = 0; i < shard_count; i++) {
+        shards.push_back(shard_template);
+        auto& shard = shards.back();
+        channel_offsets.push_back(uint32_t(assigned));
+
+        // at least one channel per shard
+        const std::size_t target = total * (i + 1) / shard_count;
+        while (it != config.channels.end() &&
+               (shard.channels.empty() || assigned < target) &&
+               std::size_t(config.channels.end() - it) > shard_count - i - 1) {
+            assigned += it->extra_fields.size() + it->polled_fields.size() + 1;
+            shard.channels.push_back(*it++);
+        }
+    }
+    return shards;
+}
+
+}
+
 Sender::Sender(const epics_diode::Config& config, const std::string& send_addresses) :
-    impl(new Impl(config, send_addresses)) {
+    shard_configs(partition_channels(config, shard_offsets)),
+    transport(new Transport(config, send_addresses, shard_configs.size()))
+{
+    create_shards();
+}
+
+Sender::Sender(const epics_diode::Config& config, const std::string& send_addresses,
+               TransmitQueue& transmitter, double weight) :
+    shard_configs(partition_channels(config, shard_offsets)),
+    transport(new Transport(config, send_addresses, shard_configs.size(), transmitter, weight))
+{
+    create_shards();
+}
+
+void Sender::create_shards()
+{
+    // a single shard runs in the calling thread
+    if (shard_configs.size() == 1) {
+        impl.reset(new Impl(shard_configs[0], *transport, 0, 0));
+        return;
+    }
+
+    for (std::size_t i = 0; i < shard_configs.size(); i++) {
+        transport->logger.log(LogLevel::Config, "Sender shard %zu: %zu channel(s), first channel id %u.",
+                    i, shard_configs[i].total_channel_count(), shard_offsets[i]);
+    }
 }
 
 Sender::~Sender() = default;
 
-void Sender::run(double runtime) {
-    impl->run(runtime);
+void Sender::run(double runtime, std::atomic<bool>* stop) {
+    if (impl) {
+        impl->run(runtime, stop);
+        return;
+    }
+
+    // each shard has its own CA context, created and used by the shard thread
+    std::atomic<bool> own_stop{false};
+    if (!stop) {
+        stop = &own_stop;
+    }
+    std::vector<std::exception_ptr> errors(shard_configs.size());
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < shard_configs.size(); i++) {
+        threads.emplace_back([this, i, runtime, stop, &errors]() {
+            try {
+                Impl shard(shard_configs[i], *transport, uint8_t(i), shard_offsets[i]);
+                shard.run(runtime, stop);
+            } catch (...) {
+                // a failed shard stops all the others
+                errors[i] = std::current_exception();
+                stop->store(true);
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
 }
 
 }
@@ -3,11 +3,14 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -16,6 +19,10 @@
 #include <epicsStdlib.h>
 #include <epicsString.h>
 
+#ifdef __linux__
+#  include <linux/net_tstamp.h>
+#endif
+
 #include <epics-diode/logger.h>
 #include <epics-diode/transport.h>
 
@@ -30,6 +37,15 @@ std::string get_socket_error_string()
     return std::string(errStr.begin());
 }
 
+std::size_t next_power_of_two(std::size_t n)
+{
+    std::size_t result = 1;
+    while (result < n) {
+        result <<= 1;
+    }
+    return result;
+}
+
 }
 
 std::string to_string(const osiSockAddr& addr)
@@ -91,6 +107,13 @@ UDPSender::~UDPSender() {
 }
 
 void UDPSender::send(const uint8_t* buffer, std::size_t length) {
+    wait_rate_limit();
+    transmit(buffer, length);
+}
+
+std::chrono::microseconds UDPSender::wait_rate_limit() {
+
+    std::chrono::microseconds delay(0);
 
     // do rate-limiting, if enabled
     if (rate_limit_mbs > 0) {
@@ -102,6 +125,7 @@ void UDPSender::send(const uint8_t* buffer, std::size_t length) {
 
         if (diff.count() > 0) {
             std::this_thread::sleep_for(diff);
+            delay = diff;
         }
 
         last_report_sent_bytes += last_sent_bytes;
@@ -115,7 +139,15 @@ void UDPSender::send(const uint8_t* buffer, std::size_t length) {
         }
     }
 
-    for (auto &address : send_addresses) {
+    return delay;
+}
+
+void UDPSender::transmit(const uint8_t* buffer, std::size_t length) {
+    transmit(buffer, length, send_addresses);
+}
+
+void UDPSender::transmit(const uint8_t* buffer, std::size_t length, const std::vector<osiSockAddr>& addresses) {
+    for (auto &address : addresses) {
         ssize_t bytes_sent = ::sendto(socket, buffer, length, 0,
                                       &address.sa, sizeof(sockaddr));
         if (bytes_sent < 0) {
@@ -131,9 +163,219 @@ void UDPSender::send(const uint8_t* buffer, std::size_t length) {
     }
 }
 
-UDPReceiver::UDPReceiver(int port, std::string listening_address) :
+IndexRing::IndexRing(std::size_t capacity) :
+    slots(next_power_of_two(capacity)),
+    mask(slots.size() - 1)
+{
+}
+
+bool IndexRing::push(uint32_t index)
+{
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == slots.size()) {
+        return false;
+    }
+    slots[t & mask] = index;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+bool IndexRing::pop(uint32_t& index)
+{
+    auto h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    index = slots[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+void Signal::notify()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        notified = true;
+    }
+    cv.notify_one();
+}
+
+void Signal::wait(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, timeout, [this]() { return notified; });
+    notified = false;
+}
+
+TransmitQueue::TransmitQueue(UDPSender& sender, std::size_t buffer_count, std::size_t buffer_size,
+                             const std::vector<std::vector<uint8_t>>& presets, PrepareCallback prepare,
+                             const std::vector<std::vector<osiSockAddr>>& lane_addresses) :
+    TransmitQueue(sender, buffer_count, buffer_size)
+{
+    add_lanes(presets, std::move(prepare), lane_addresses);
+    start();
+}
+
+TransmitQueue::TransmitQueue(UDPSender& sender, std::size_t buffer_count, std::size_t buffer_size) :
+    logger("transport.transmit"),
+    sender(sender),
+    buffer_count(std::max(buffer_count, std::size_t(2))),
+    buffer_size(buffer_size)
+{
+}
+
+TransmitQueue::~TransmitQueue()
+{
+    if (thread.joinable()) {
+        stop.store(true, std::memory_order_release);
+        ready_signal.notify();
+        thread.join();
+    }
+}
+
+std::size_t TransmitQueue::add_lanes(const std::vector<std::vector<uint8_t>>& presets, PrepareCallback prepare,
+                                     const std::vector<std::vector<osiSockAddr>>& lane_addresses, double weight)
+{
+    if (thread.joinable()) {
+        throw std::logic_error("Lanes cannot be added to a running transmit queue.");
+    }
+    if (!(weight > 0)) {
+        throw std::invalid_argument("Lane group weight must be positive.");
+    }
+
+    std::size_t first_lane = lanes.size();
+    for (std::size_t i = 0; i < presets.size(); i++) {
+        auto& preset = presets[i];
+        std::unique_ptr<Lane> lane(new Lane(buffer_count));
+        lane->addresses = (i < lane_addresses.size()) ? lane_addresses[i] : sender.addresses();
+        lane->prepare = prepare;
+        for (uint32_t j = 0; j < buffer_count; j++) {
+            auto& data = lane->packets[j].data;
+            data.resize(buffer_size);
+            std::copy(preset.begin(), preset.end(), data.begin());
+            lane->free_ring.push(j);
+        }
+        lanes.push_back(std::move(lane));
+    }
+
+    groups.emplace_back(first_lane, presets.size(), weight);
+    return first_lane;
+}
+
+void TransmitQueue::start()
+{
+    // every group with a pending packet sends at least one (max. size) packet per round
+    double min_weight = std::numeric_limits<double>::max();
+    double total_weight = 0.0;
+    for (auto& group : groups) {
+        min_weight = std::min(min_weight, group.weight);
+        total_weight += group.weight;
+    }
+    for (auto& group : groups) {
+        group.quantum = std::size_t(buffer_size * group.weight / min_weight);
+        if (groups.size() > 1) {
+            logger.log(LogLevel::Config, "Transmit lane group of %zu lane(s), bandwidth share %.1f%%.",
+                        group.lane_count, 100.0 * group.weight / total_weight);
+        }
+    }
+
+    logger.log(LogLevel::Config, "Transmit thread with %zu lane(s) of %zu packet buffers.", lanes.size(), buffer_count);
+    thread = std::thread(&TransmitQueue::run, this);
+}
+
+std::vector<uint8_t>& TransmitQueue::buffer(std::size_t lane_index)
+{
+    auto& lane = *lanes[lane_index];
+    while (lane.current == NO_BUFFER && !lane.free_ring.pop(lane.current)) {
+        // all buffers in flight, wait for the transmit thread
+        lane.free_signal.wait(std::chrono::milliseconds(10));
+    }
+    return lane.packets[lane.current].data;
+}
+
+void TransmitQueue::commit(std::size_t lane_index, std::size_t length, std::size_t prepare_offset)
+{
+    buffer(lane_index);
+
+    auto& lane = *lanes[lane_index];
+    auto& packet = lane.packets[lane.current];
+    packet.length = length;
+    packet.prepare_offset = prepare_offset;
+    packet.commit_time = clock_type::now();
+
+    // cannot fail, there are no more indices than slots
+    lane.ready_ring.push(lane.current);
+    lane.current = NO_BUFFER;
+    ready_signal.notify();
+}
+
+TransmitQueue::Lane* TransmitQueue::next_ready_lane(Group& group)
+{
+    for (std::size_t i = 0; i < group.lane_count; i++) {
+        std::size_t index = (group.next_lane + i) % group.lane_count;
+        auto& lane = *lanes[group.first_lane + index];
+        if (lane.next != NO_BUFFER || lane.ready_ring.pop(lane.next)) {
+            group.next_lane = index;
+            return &lane;
+        }
+    }
+    return nullptr;
+}
+
+void TransmitQueue::transmit(Lane& lane)
+{
+    auto& packet = lane.packets[lane.next];
+    if (!lane.addresses.empty()) {
+        sender.wait_rate_limit();
+        if (packet.prepare_offset && lane.prepare) {
+            auto delay = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - packet.commit_time);
+            lane.prepare(packet.data.data(), packet.prepare_offset, delay);
+        }
+        sender.transmit(packet.data.data(), packet.length, lane.addresses);
+    }
+
+    lane.free_ring.push(lane.next);
+    lane.next = NO_BUFFER;
+    lane.free_signal.notify();
+}
+
+void TransmitQueue::run()
+{
+    while (true) {
+        // one quantum of each group with pending packets per round, one packet of each lane of a group in turn
+        bool sent = false;
+        for (auto& group : groups) {
+            Lane* lane = next_ready_lane(group);
+            if (lane) {
+                group.deficit += group.quantum;
+            }
+            while (lane && lane->packets[lane->next].length <= group.deficit) {
+                group.deficit -= lane->packets[lane->next].length;
+                transmit(*lane);
+                sent = true;
+                group.next_lane = (group.next_lane + 1) % group.lane_count;
+                lane = next_ready_lane(group);
+            }
+            if (!lane) {
+                // unused share is not saved for later, it is taken by the other groups
+                group.deficit = 0;
+            }
+        }
+
+        if (!sent) {
+            // drain the queues before stopping
+            if (stop.load(std::memory_order_acquire)) {
+                break;
+            }
+            ready_signal.wait(std::chrono::milliseconds(100));
+        }
+    }
+}
+
+UDPReceiver::UDPReceiver(int port, std::string listening_address, bool rx_timestamps) :
     logger("transport.receiver"),
-    socket(epicsSocketCreate(AF_INET, SOCK_DGRAM, IPPROTO_UDP))
+    socket(epicsSocketCreate(AF_INET, SOCK_DGRAM, IPPROTO_UDP)),
+    rx_timestamps(false)
 {
     if (socket == INVALID_SOCKET)
     {
@@ -176,6 +418,22 @@ UDPReceiver::UDPReceiver(int port, std::string listening_address) :
         throw std::runtime_error(std::string("Error setting SO_RCVTIMEO: ") + 
             get_socket_error_string());
     }
+
+    // enable kernel receive timestamps, not fatal if not supported
+    if (rx_timestamps) {
+#ifdef SO_TIMESTAMPING
+        int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        status = ::setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPING,
+                              (char*)&flags, sizeof(flags));
+        if (status) {
+            logger.log(LogLevel::Warning, "Error setting SO_TIMESTAMPING: %s", get_socket_error_string().c_str());
+        } else {
+            this->rx_timestamps = true;
+        }
+#else
+        logger.log(LogLevel::Warning, "Kernel receive timestamps not supported on this platform.");
+#endif
+    }
 }
 
 UDPReceiver::~UDPReceiver() {
@@ -184,11 +442,53 @@ UDPReceiver::~UDPReceiver() {
     }
 }
 
-ssize_t UDPReceiver::receive(const uint8_t* buffer, std::size_t length, osiSockAddr* fromAddress) {
+ssize_t UDPReceiver::receive(const uint8_t* buffer, std::size_t length, osiSockAddr* fromAddress,
+                             std::chrono::system_clock::time_point* rx_time) {
     osiSocklen_t addrStructSize = sizeof(sockaddr);
-    
-    ssize_t bytes_read = ::recvfrom(socket, (void*)buffer, length, 0,
-                                    (sockaddr*)fromAddress, &addrStructSize);
+    ssize_t bytes_read;
+
+#ifdef SO_TIMESTAMPING
+    if (rx_timestamps) {
+        std::array<char, CMSG_SPACE(sizeof(timespec) * 3)> control{};
+        iovec iov{};
+        iov.iov_base = (void*)buffer;
+        iov.iov_len = length;
+
+        msghdr msg{};
+        msg.msg_name = (sockaddr*)fromAddress;
+        msg.msg_namelen = addrStructSize;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+
+        bytes_read = ::recvmsg(socket, &msg, 0);
+
+        if (bytes_read > 0 && rx_time) {
+            *rx_time = std::chrono::system_clock::now();
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                    // software timestamp is the first one
+                    timespec ts;
+                    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                    if (ts.tv_sec || ts.tv_nsec) {
+                        *rx_time = std::chrono::system_clock::time_point(
+                            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+                    }
+                }
+            }
+        }
+    } else
+#endif
+    {
+        bytes_read = ::recvfrom(socket, (void*)buffer, length, 0,
+                                (sockaddr*)fromAddress, &addrStructSize);
+        if (bytes_read > 0 && rx_time) {
+            *rx_time = std::chrono::system_clock::now();
+        }
+    }
+
     if (bytes_read > 0) {
         if (logger.is_loggable(LogLevel::Debug)) {
             logger.log(LogLevel::Debug, "Received %zd bytes from %s.", bytes_read, to_string(*fromAddress).c_str());
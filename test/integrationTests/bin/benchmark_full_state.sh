@@ -0,0 +1,78 @@
+#!/bin/sh
+
+#
+# Time to full state benchmark: runs the test's diode_sender configuration
+# plain, with 'connect_batch_size', with a cold and with a warm 'channel_cache',
+# and reports the time to full state logged by the sender.
+#
+# USAGE: benchmark_full_state.sh <TEST_NAME> [<CONNECT_BATCH_SIZE>] [<RUNTIME>]
+#
+# Meant for tests with large configurations (I23, I28, I33).
+#
+
+cd `dirname $0`
+
+if [ ! $1 ]; then
+    echo "USAGE: $0 <TEST_NAME> [<CONNECT_BATCH_SIZE>] [<RUNTIME>]"
+    exit 1
+fi
+
+TEST=$1
+BATCH_SIZE=${2:-1000}
+RUNTIME=${3:-60}
+
+TEST_DOES_NOT_EXISTS=0
+. ./prepare_test_env.sh $TEST
+cd "$BINFOLDER"
+
+if [ 1 -eq $TEST_DOES_NOT_EXISTS ]; then
+    echo "Test '$TEST' does not exists!"
+    exit 1
+fi
+
+CONFIG="$TEST_VOLUMES_FOLDER/config/diode.json"
+CACHE="/test_config/benchmark.cache"
+
+# Writes a copy of the test configuration with the given options added.
+write_config() {
+    sed "0,/{/s|{|{ $2|" "$CONFIG" > "$TEST_VOLUMES_FOLDER/config/benchmark_$1.json"
+}
+
+# Runs the sender with the given configuration, prints the time to full state
+# (the slowest shard) or 'n/a' if the full state was not reached within the runtime.
+run_sender() {
+    docker exec \
+        modules-poz-1 /bin/bash -o pipefail -c "
+            export EPICS_CA_AUTO_ADDR_LIST=no
+            export EPICS_CA_ADDR_LIST=poz
+            cd /epics-diode/bin/linux-x86_64 &&
+            ./diode_sender -r $RUNTIME -c /test_config/benchmark_$1.json xpoz:5080 2>&1
+        " | \
+    sed -n 's/.*Full state of [0-9]* channel(s) sent \([0-9.]*\)s after startup.*/\1/p' | \
+    sort -n | tail -1 | grep . || echo "n/a"
+}
+
+./run_test.sh $TEST clean || exit 1
+./run_test.sh $TEST up || exit 1
+
+# the benchmark runs its own sender
+docker exec modules-poz-1 screen -S diode_sender -X quit
+
+write_config plain ""
+write_config batch "\"connect_batch_size\": $BATCH_SIZE,"
+write_config cache "\"connect_batch_size\": $BATCH_SIZE, \"channel_cache\": \"$CACHE\","
+docker exec modules-poz-1 /bin/bash -c "rm -f $CACHE*"
+
+PLAIN=`run_sender plain`
+BATCH=`run_sender batch`
+COLD=`run_sender cache`
+WARM=`run_sender cache`
+
+./run_test.sh $TEST down
+rm -f "$TEST_VOLUMES_FOLDER"/config/benchmark_*.json
+
+echo "Time to full state of $TEST [s]:"
+echo "  plain                        : $PLAIN"
+echo "  connect_batch_size           : $BATCH (batch size $BATCH_SIZE)"
+echo "  batch + channel_cache (cold) : $COLD"
+echo "  batch + channel_cache (warm) : $WARM"
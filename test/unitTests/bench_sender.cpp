@@ -0,0 +1,113 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+// Send path benchmark: CA events of a large channel table are processed (process_event)
+// and sent (send_updates) to a loopback address. No CA server is needed, channels are
+// marked connected and the events are synthesized.
+//
+// usage: bench_sender [<channels> [<iterations> [<events per iteration>]]]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <envDefs.h>
+
+// internals of the sender (anonymous namespace, Sender::Impl) are benchmarked directly
+#include "../../src/sender.cpp"
+
+namespace epics_diode {
+
+struct SenderBenchmark {
+    static void run(std::size_t channel_count, std::size_t iterations, std::size_t events_per_iteration);
+};
+
+void SenderBenchmark::run(std::size_t channel_count, std::size_t iterations, std::size_t events_per_iteration)
+{
+    using secs = std::chrono::duration<double>;
+    using clock_type = std::chrono::steady_clock;
+
+    Config config;
+    config.rate_limit_mbs = 0;
+    config.heartbeat_period = 1e6;      // heartbeats are not part of the benchmark
+    for (std::size_t i = 0; i < channel_count; i++) {
+        config.channels.emplace_back("bench:ch" + std::to_string(i));
+    }
+    config.update_hash();
+
+    SocketContext socket_context;
+    Sender::Transport transport(config, "127.0.0.1", 1);
+    Sender::Impl impl(config, transport, 0, 0);
+
+    // connected scalar doubles
+    for (auto& ch : impl.channels) {
+        ch.channel_type = DBR_DOUBLE;
+        ch.element_count = 1;
+        set_dbr_type(&ch);
+        ch.status = ECA_NORMAL;
+    }
+
+    dbr_time_double dbr{};
+    double process_time = 0;
+    double send_time = 0;
+    std::size_t events = 0;
+    uint16_t first_seq_no = impl.seq_no;
+    std::size_t messages = 0;
+    std::size_t next = 0;
+
+    for (std::size_t n = 0; n < iterations; n++) {
+        auto start = clock_type::now();
+        for (std::size_t e = 0; e < events_per_iteration; e++) {
+            auto& ch = impl.channels[next];
+            next = (next + 1) % impl.channels.size();
+            dbr.value = double(n * events_per_iteration + e);
+            process_event(&ch, ECA_NORMAL, DBR_TIME_DOUBLE, 1, &dbr);
+        }
+        events += events_per_iteration;
+        auto processed = clock_type::now();
+
+        ++impl.iteration;
+        impl.send_updates();
+        auto sent = clock_type::now();
+
+        messages += uint16_t(impl.seq_no - first_seq_no);
+        first_seq_no = impl.seq_no;
+        process_time += secs(processed - start).count();
+        send_time += secs(sent - processed).count();
+    }
+
+    std::printf("%zu channel(s), %zu iteration(s), %zu event(s) per iteration\n",
+                channel_count, iterations, events_per_iteration);
+    std::printf("process_event: %8.1f ns/event\n", process_time * 1e9 / events);
+    std::printf("send_updates:  %8.1f ns/update, %zu message(s), %.1f update(s)/message\n",
+                send_time * 1e9 / events, messages, messages ? double(events) / messages : 0.0);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t channel_count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::size_t iterations = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 100;
+    std::size_t events_per_iteration = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : channel_count / 10;
+    if (!channel_count || !iterations || !events_per_iteration) {
+        std::fprintf(stderr, "usage: %s [<channels> [<iterations> [<events per iteration>]]]\n", argv[0]);
+        return 1;
+    }
+
+    // no CA server, channels are never searched for
+    epicsEnvSet("EPICS_CA_AUTO_ADDR_LIST", "NO");
+    epicsEnvSet("EPICS_CA_ADDR_LIST", "");
+    epics_diode::Logger::set_default_log_level(epics_diode::LogLevel::Warning);
+
+    try {
+        epics_diode::SenderBenchmark::run(channel_count, iterations, events_per_iteration);
+    } catch (std::exception& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,315 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "testMain.h"
+#include "epicsUnitTest.h"
+
+#include <cadef.h>
+
+#include <epics-diode/config.h>
+#include <epics-diode/destination.h>
+#include <epics-diode/logger.h>
+#include <epics-diode/protocol.h>
+#include <epics-diode/transport.h>
+
+
+namespace edi = epics_diode;
+
+namespace {
+
+const uint64_t STARTUP_TIME = 1;
+
+// Channels 0 and 2 (destination ids 0 and 1) are sent to the destination, channel 1 is not.
+edi::Config test_config()
+{
+    edi::Config config;
+    config.channels.push_back(edi::ConfigChannel("a:one"));
+    config.channels.push_back(edi::ConfigChannel("b:two"));
+    config.channels.push_back(edi::ConfigChannel("a:three"));
+
+    edi::ConfigDestination destination;
+    destination.name = "A";
+    destination.address = "127.0.0.1";
+    destination.channels.push_back("a:*");
+    config.destinations.push_back(destination);
+
+    config.update_hash();
+    return config;
+}
+
+// DBR_TIME_DOUBLE scalar value
+std::vector<uint8_t> to_dbr(double value)
+{
+    std::vector<uint8_t> dbr(dbr_size_n(DBR_TIME_DOUBLE, 1));
+    memcpy(dbr.data() + offsetof(dbr_time_double, value), &value, sizeof(value));
+    return dbr;
+}
+
+double from_dbr(const uint8_t* dbr)
+{
+    double value;
+    memcpy(&value, dbr + offsetof(dbr_time_double, value), sizeof(value));
+    return value;
+}
+
+// Message of the entire configuration, written as the sender does.
+struct MessageWriter {
+    std::vector<uint8_t> buffer;
+    edi::Serializer s;
+    edi::Serializer::value_type* subheader_pos = nullptr;
+    uint8_t id = 0;
+
+    explicit MessageWriter(const edi::Config& config) :
+        buffer(edi::MAX_MESSAGE_SIZE),
+        s(buffer.data(), buffer.size())
+    {
+        s << edi::Header(STARTUP_TIME, config.hash);
+    }
+
+    void begin_submessage(uint8_t submessage_id) {
+        if (subheader_pos) {
+            write_subheader(uint16_t(s.position() - subheader_pos - edi::SubmessageHeader::size));
+        }
+        subheader_pos = s.position();
+        id = submessage_id;
+        s << edi::SubmessageHeader(id, edi::SubmessageFlag::LittleEndian, 0);
+    }
+
+    void write_subheader(uint16_t bytes_to_next_header) {
+        auto pos = s.position();
+        s.position(subheader_pos);
+        s << edi::SubmessageHeader(id, edi::SubmessageFlag::LittleEndian, bytes_to_next_header);
+        s.position(pos);
+    }
+
+    void data(uint16_t seq_no, const std::vector<uint32_t>& ids, double value) {
+        begin_submessage(edi::SubmessageType::CA_DATA_MESSAGE);
+        s << edi::CADataMessage(seq_no, uint16_t(ids.size()));
+        for (auto channel_id : ids) {
+            auto dbr = to_dbr(value + channel_id);
+            s << edi::CAChannelData(channel_id, 1, DBR_TIME_DOUBLE);
+            s.write(dbr.data(), dbr.size());
+            s.pad_align(edi::SubmessageHeader::alignment, 0);
+        }
+    }
+
+    void refresh(const std::vector<edi::CAChannelRefresh>& refreshes) {
+        begin_submessage(edi::SubmessageType::CA_REFRESH_MESSAGE);
+        s << edi::CARefreshMessage(uint16_t(refreshes.size()));
+        for (auto& refresh : refreshes) {
+            s << refresh;
+        }
+        s.pad_align(edi::SubmessageHeader::alignment, 0);
+    }
+
+    void delta(uint16_t seq_no, uint16_t base_generation, uint32_t channel_id, double value) {
+        begin_submessage(edi::SubmessageType::CA_DELTA_DATA_MESSAGE);
+        s << edi::CADeltaDataMessage(seq_no, base_generation, channel_id, 1, DBR_TIME_DOUBLE, 1);
+        s << edi::CADeltaRange(offsetof(dbr_time_double, value), sizeof(value));
+        s.write(reinterpret_cast<const uint8_t*>(&value), sizeof(value));
+    }
+
+    void fragment(uint16_t seq_no, uint16_t fragment_seq_no, uint32_t channel_id) {
+        begin_submessage(edi::SubmessageType::CA_FRAG_DATA_MESSAGE);
+        std::vector<uint8_t> fragment(64, uint8_t(fragment_seq_no));
+        s << edi::CAFragDataMessage(seq_no, fragment_seq_no, channel_id, 20000, DBR_TIME_DOUBLE,
+                                    uint16_t(fragment.size()));
+        s.write(fragment.data(), fragment.size());
+    }
+
+    std::size_t length() const {
+        return s.distance();
+    }
+};
+
+// Rewritten message, submessages are read as the receiver does.
+struct MessageReader {
+    std::vector<edi::SubmessageHeader> subheaders;
+    std::vector<edi::Serializer> payloads;
+
+    MessageReader(uint8_t* message, std::size_t length) {
+        edi::Serializer s(message, length);
+        s += edi::Header::size;
+        while (s.ensure(edi::SubmessageHeader::size)) {
+            edi::SubmessageHeader subheader;
+            s >> subheader;
+            auto payload_end = message + length;
+            if (subheader.bytes_to_next_header) {
+                payload_end = s.position() + subheader.bytes_to_next_header;
+            }
+            // alignment is relative to the start of the message
+            edi::Serializer payload(message, std::size_t(payload_end - message));
+            payload += std::size_t(s.position() - message);
+            subheaders.push_back(subheader);
+            payloads.push_back(payload);
+            if (subheader.bytes_to_next_header == 0 || !s.try_position(payload_end)) {
+                break;
+            }
+        }
+    }
+
+    std::size_t count() const {
+        return subheaders.size();
+    }
+};
+
+void test_rewrite()
+{
+    auto config = test_config();
+    edi::Destination destination(config, config.destinations[0]);
+    testOk(destination.channel_count == 2 && destination.map_id(0) == 0 && destination.map_id(1) == edi::Destination::NO_ID &&
+           destination.map_id(2) == 1, "Destination channel ids.");
+
+    edi::DestinationStream stream(destination, 0);
+    std::vector<uint8_t> out(edi::MAX_MESSAGE_SIZE);
+    std::size_t prepare_offset = 0;
+
+    testDiag("Data of the destination channels.");
+    {
+        MessageWriter w(config);
+        w.data(10, {0, 1, 2}, 100);
+        auto length = stream.rewrite(w.buffer.data(), w.length(), out.data(), prepare_offset);
+        MessageReader r(out.data(), length);
+
+        edi::CADataMessage data_msg;
+        edi::CAChannelData first, second;
+        bool ok = (r.count() == 1 && r.subheaders[0].id == edi::SubmessageType::CA_DATA_MESSAGE);
+        if (ok) {
+            auto& s = r.payloads[0];
+            s >> data_msg >> first;
+            double first_value = from_dbr(s.position());
+            s += dbr_size_n(DBR_TIME_DOUBLE, 1);
+            s.pos_align(edi::SubmessageHeader::alignment, 0);
+            s >> second;
+            double second_value = from_dbr(s.position());
+            ok = s && data_msg.seq_no == 0 && data_msg.channel_count == 2 &&
+                 first.id == 0 && first_value == 100 && second.id == 1 && second_value == 102;
+        }
+        testOk(ok, "Channel ids translated, other channels dropped, destination seq_no used.");
+    }
+
+    testDiag("Data of other channels only.");
+    {
+        MessageWriter w(config);
+        w.data(11, {1}, 200);
+        testOk(stream.rewrite(w.buffer.data(), w.length(), out.data(), prepare_offset) == 0,
+               "Nothing to be sent, no seq_no taken.");
+    }
+
+    testDiag("Refreshes of known and unknown generations.");
+    {
+        MessageWriter w(config);
+        w.data(12, {1}, 300);
+        w.refresh({edi::CAChannelRefresh(0, 10, 1234), edi::CAChannelRefresh(2, 7, 5678)});
+        auto length = stream.rewrite(w.buffer.data(), w.length(), out.data(), prepare_offset);
+        MessageReader r(out.data(), length);
+
+        edi::CADataMessage data_msg;
+        edi::CARefreshMessage refresh_msg;
+        edi::CAChannelRefresh refresh;
+        bool ok = (r.count() == 2 &&
+                   r.subheaders[0].id == edi::SubmessageType::CA_DATA_MESSAGE &&
+                   r.subheaders[1].id == edi::SubmessageType::CA_REFRESH_MESSAGE);
+        if (ok) {
+            r.payloads[0] >> data_msg;
+            r.payloads[1] >> refresh_msg >> refresh;
+            ok = r.payloads[1] && data_msg.seq_no == 1 && data_msg.channel_count == 0 &&
+                 refresh_msg.channel_count == 1 && refresh.id == 0 && refresh.generation == 0 &&
+                 refresh.value_hash == 1234;
+        }
+        testOk(ok, "Known generation translated, unknown generation dropped.");
+    }
+
+    testDiag("Deltas on top of known and unknown (lost) values.");
+    {
+        MessageWriter w(config);
+        w.delta(13, 10, 2, 400);
+        auto length = stream.rewrite(w.buffer.data(), w.length(), out.data(), prepare_offset);
+        MessageReader r(out.data(), length);
+
+        edi::CADeltaDataMessage delta_msg;
+        edi::CADeltaRange range;
+        bool ok = (r.count() == 1 && r.subheaders[0].id == edi::SubmessageType::CA_DELTA_DATA_MESSAGE);
+        if (ok) {
+            auto& s = r.payloads[0];
+            s >> delta_msg >> range;
+            double value = 0;
+            if (s.ensure(sizeof(value))) {
+                memcpy(&value, s.position(), sizeof(value));
+            }
+            ok = s && delta_msg.seq_no == 2 && delta_msg.base_generation == 0 && delta_msg.channel_id == 1 &&
+                 range.offset == offsetof(dbr_time_double, value) && range.size_bytes == sizeof(value) && value == 400;
+        }
+        testOk(ok, "Delta base generation and channel id translated.");
+
+        MessageWriter lost(config);
+        lost.delta(14, 12, 2, 500);
+        testOk(stream.rewrite(lost.buffer.data(), lost.length(), out.data(), prepare_offset) == 0,
+               "Delta on top of an unknown value dropped.");
+    }
+
+    testDiag("Fragments received out of order.");
+    {
+        MessageWriter late(config);
+        late.fragment(20, 1, 2);
+        testOk(stream.rewrite(late.buffer.data(), late.length(), out.data(), prepare_offset) == 0,
+               "Fragment of a transfer not started dropped.");
+
+        MessageWriter first(config);
+        first.fragment(20, 0, 2);
+        auto length = stream.rewrite(first.buffer.data(), first.length(), out.data(), prepare_offset);
+        MessageReader r(out.data(), length);
+        edi::CAFragDataMessage frag_msg;
+        bool ok = (r.count() == 1 && r.subheaders[0].id == edi::SubmessageType::CA_FRAG_DATA_MESSAGE);
+        if (ok) {
+            r.payloads[0] >> frag_msg;
+            ok = r.payloads[0] && frag_msg.seq_no == 3 && frag_msg.fragment_seq_no == 0 && frag_msg.channel_id == 1;
+        }
+        testOk(ok, "First fragment takes the destination seq_no.");
+
+        MessageWriter next(config);
+        next.fragment(20, 1, 2);
+        length = stream.rewrite(next.buffer.data(), next.length(), out.data(), prepare_offset);
+        MessageReader rn(out.data(), length);
+        ok = (rn.count() == 1 && rn.subheaders[0].id == edi::SubmessageType::CA_FRAG_DATA_MESSAGE);
+        if (ok) {
+            rn.payloads[0] >> frag_msg;
+            ok = rn.payloads[0] && frag_msg.seq_no == 3 && frag_msg.fragment_seq_no == 1 && frag_msg.channel_id == 1;
+        }
+        testOk(ok, "Following fragment translated to the seq_no of the transfer.");
+
+        MessageWriter delta(config);
+        delta.delta(21, 20, 2, 600);
+        length = stream.rewrite(delta.buffer.data(), delta.length(), out.data(), prepare_offset);
+        MessageReader rd(out.data(), length);
+        edi::CADeltaDataMessage delta_msg;
+        ok = (rd.count() == 1 && rd.subheaders[0].id == edi::SubmessageType::CA_DELTA_DATA_MESSAGE);
+        if (ok) {
+            rd.payloads[0] >> delta_msg;
+            ok = rd.payloads[0] && delta_msg.seq_no == 4 && delta_msg.base_generation == 3;
+        }
+        testOk(ok, "Delta on top of a fragmented value translated.");
+    }
+}
+
+}
+
+
+MAIN(test_destination)
+{
+    testPlan(10);
+
+    edi::Logger::set_default_log_level(edi::LogLevel::Error);
+    edi::SocketContext socket_context;
+
+    test_rewrite();
+
+    return testDone();
+}
@@ -12,7 +12,7 @@ namespace edi = epics_diode;
 
 const char* const TEST_EPICS_DIODE_CONFIG_FILENAME("../test_diode_config.json");
 
-const std::size_t REF_HASH = 14358125269606085529ULL;
+const std::size_t REF_HASH = 8110334191076226896ULL;
 const double REF_MIN_UPDATE_PERIOD = 0.025;
 const double REF_POLLED_FIELDS_UPDATE_PERIOD = 6.0;
 const double REF_HEARTBEAT_PERIOD = 30.0;
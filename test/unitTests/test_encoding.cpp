@@ -0,0 +1,106 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "testMain.h"
+#include "epicsUnitTest.h"
+
+#include <cadef.h>
+
+#include <epics-diode/config.h>
+#include <epics-diode/encoding.h>
+
+
+namespace edi = epics_diode;
+
+namespace {
+
+const double SCALE = 0.5;
+const double OFFSET = 10.0;
+
+// largest and smallest quantized values, -32768 is reserved for NaN
+const double MAX_VALUE = 32767 * SCALE + OFFSET;
+const double MIN_VALUE = -32767 * SCALE + OFFSET;
+
+// DBR_TIME_DOUBLE value
+std::vector<uint8_t> to_dbr(const std::vector<double>& values)
+{
+    std::vector<uint8_t> dbr(dbr_size_n(DBR_TIME_DOUBLE, values.size()));
+    memcpy(dbr.data() + offsetof(dbr_time_double, value), values.data(), values.size() * sizeof(double));
+    return dbr;
+}
+
+std::vector<double> from_dbr(const std::vector<uint8_t>& dbr)
+{
+    constexpr std::size_t value_offset = offsetof(dbr_time_double, value);
+    std::vector<double> values((dbr.size() - value_offset) / sizeof(double));
+    memcpy(values.data(), dbr.data() + value_offset, values.size() * sizeof(double));
+    return values;
+}
+
+// Encodes and decodes 'values' with int16 encoding.
+std::vector<double> round_trip(const std::vector<double>& values, bool delta_encoding)
+{
+    edi::ConfigChannel config_channel("test:encoded");
+    config_channel.encoding = edi::Encoding::int16;
+    config_channel.encoding_scale = SCALE;
+    config_channel.encoding_offset = OFFSET;
+    config_channel.delta_encoding = delta_encoding;
+    edi::ValueEncoding encoding(config_channel);
+
+    auto dbr = to_dbr(values);
+    std::vector<uint8_t> encoded;
+    auto type = encoding.encode(dbr.data(), long(values.size()), encoded);
+
+    std::vector<uint8_t> decoded;
+    if (!encoding.decode(type, encoded.data(), long(values.size()), decoded)) {
+        return std::vector<double>();
+    }
+    return from_dbr(decoded);
+}
+
+void test_int16_round_trip(bool delta_encoding)
+{
+    testDiag("int16 encoding round trip%s.", delta_encoding ? " (delta encoding)" : "");
+
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<double> values = {
+        1.2, nan, inf, -inf, MAX_VALUE, MIN_VALUE, MAX_VALUE + 1e9, MIN_VALUE - 1e9, nan
+    };
+
+    auto result = round_trip(values, delta_encoding);
+    if (result.size() != values.size()) {
+        testFail("Value decoded (%zu element(s)).", result.size());
+        testSkip(3, "value not decoded");
+        return;
+    }
+
+    testOk(result[0] == 1.0, "Value quantized to the nearest step (%g).", result[0]);
+    testOk(std::isnan(result[1]) && std::isnan(result[8]), "NaN preserved (%g, %g).", result[1], result[8]);
+    testOk(result[2] == MAX_VALUE && result[3] == MIN_VALUE, "Infinities saturated (%g, %g).",
+           result[2], result[3]);
+    testOk(result[4] == MAX_VALUE && result[5] == MIN_VALUE && result[6] == MAX_VALUE && result[7] == MIN_VALUE,
+           "Limits preserved, out of range values saturated (%g, %g, %g, %g).",
+           result[4], result[5], result[6], result[7]);
+}
+
+}
+
+
+MAIN(test_encoding)
+{
+    testPlan(8);
+
+    test_int16_round_trip(false);
+    test_int16_round_trip(true);
+
+    return testDone();
+}
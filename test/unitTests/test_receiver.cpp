@@ -0,0 +1,305 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "testMain.h"
+#include "epicsUnitTest.h"
+
+#include <cadef.h>
+
+#include <epics-diode/config.h>
+#include <epics-diode/logger.h>
+#include <epics-diode/protocol.h>
+#include <epics-diode/receiver.h>
+#include <epics-diode/transport.h>
+
+
+namespace edi = epics_diode;
+
+namespace {
+
+// Messages are serialized as the sender does and sent to a receiver over the loopback interface.
+const int TEST_PORT = 15080;
+const uint64_t STARTUP_TIME = 1;
+const uint32_t ARRAY_CHANNEL = 0;       // partial (delta) array updates
+const uint32_t WAVEFORM_CHANNEL = 1;    // values sent in fragments
+const std::size_t WAVEFORM_COUNT = 20000;
+
+edi::Config test_config()
+{
+    edi::Config config;
+    config.beacon_period = 0;           // no link loss, messages are not sent continuously
+    edi::ConfigChannel array_channel("test:array");
+    array_channel.array_delta = true;
+    config.channels.push_back(array_channel);
+    config.channels.push_back(edi::ConfigChannel("test:waveform"));
+    config.update_hash();
+    return config;
+}
+
+std::vector<uint8_t> to_bytes(const std::vector<double>& values)
+{
+    std::vector<uint8_t> bytes(values.size() * sizeof(double));
+    memcpy(bytes.data(), values.data(), bytes.size());
+    return bytes;
+}
+
+// DBR_TIME_DOUBLE value
+std::vector<uint8_t> to_dbr(const std::vector<double>& values)
+{
+    std::vector<uint8_t> dbr(dbr_size_n(DBR_TIME_DOUBLE, values.size()));
+    memcpy(dbr.data() + offsetof(dbr_time_double, value), values.data(), values.size() * sizeof(double));
+    return dbr;
+}
+
+std::vector<double> from_dbr(const std::vector<uint8_t>& dbr)
+{
+    constexpr std::size_t value_offset = offsetof(dbr_time_double, value);
+    if (dbr.size() < value_offset) {
+        return std::vector<double>();
+    }
+    std::vector<double> values((dbr.size() - value_offset) / sizeof(double));
+    memcpy(values.data(), dbr.data() + value_offset, values.size() * sizeof(double));
+    return values;
+}
+
+// byte offset of an array element within DBR_TIME_DOUBLE value
+uint32_t element_offset(std::size_t index)
+{
+    return uint32_t(offsetof(dbr_time_double, value) + index * sizeof(double));
+}
+
+// Message with a single submessage (extends until the end of the message).
+struct MessageWriter {
+    std::vector<uint8_t> buffer;
+    edi::Serializer s;
+
+    MessageWriter(const edi::Config& config, uint8_t submessage_id) :
+        buffer(edi::MAX_MESSAGE_SIZE),
+        s(buffer.data(), buffer.size())
+    {
+        s << edi::Header(STARTUP_TIME, config.hash);
+        s << edi::SubmessageHeader(submessage_id, edi::SubmessageFlag::LittleEndian, 0);
+    }
+
+    std::vector<uint8_t> message() {
+        buffer.resize(s.distance());
+        return buffer;
+    }
+};
+
+std::vector<uint8_t> data_message(const edi::Config& config, uint16_t seq_no, uint32_t id,
+                                  const std::vector<double>& values)
+{
+    MessageWriter w(config, edi::SubmessageType::CA_DATA_MESSAGE);
+    auto dbr = to_dbr(values);
+    w.s << edi::CADataMessage(seq_no, 1);
+    w.s << edi::CAChannelData(id, uint16_t(values.size()), DBR_TIME_DOUBLE);
+    w.s.write(dbr.data(), dbr.size());
+    w.s.pad_align(edi::SubmessageHeader::alignment, 0);
+    return w.message();
+}
+
+using DeltaRanges = std::vector<std::pair<uint32_t, std::vector<double>>>;    // byte offset, elements
+
+std::vector<uint8_t> delta_message(const edi::Config& config, uint16_t seq_no, uint16_t base_generation,
+                                   uint32_t id, uint32_t count, const DeltaRanges& ranges)
+{
+    MessageWriter w(config, edi::SubmessageType::CA_DELTA_DATA_MESSAGE);
+    w.s << edi::CADeltaDataMessage(seq_no, base_generation, id, count, DBR_TIME_DOUBLE, uint16_t(ranges.size()));
+    for (auto& range : ranges) {
+        auto bytes = to_bytes(range.second);
+        w.s << edi::CADeltaRange(range.first, uint32_t(bytes.size()));
+        w.s.write(bytes.data(), bytes.size());
+        w.s.pad_align(edi::SubmessageHeader::alignment, 0);
+    }
+    return w.message();
+}
+
+std::vector<uint8_t> disconnect_message(const edi::Config& config, uint16_t seq_no, uint32_t id)
+{
+    MessageWriter w(config, edi::SubmessageType::CA_DATA_MESSAGE);
+    w.s << edi::CADataMessage(seq_no, 1);
+    w.s << edi::CAChannelData(id, (uint16_t)-1, DBR_TIME_DOUBLE);
+    return w.message();
+}
+
+// Fragments of a value, fragment_seq_no-th one.
+std::vector<uint8_t> fragment_message(const edi::Config& config, uint16_t seq_no, uint16_t fragment_seq_no,
+                                      uint32_t id, const std::vector<double>& values)
+{
+    constexpr std::size_t max_fragment_size = edi::CAFragDataMessage::max_fragment_size;
+    auto dbr = to_dbr(values);
+    auto offset = fragment_seq_no * max_fragment_size;
+    auto fragment_size = std::min(max_fragment_size, dbr.size() - offset);
+
+    MessageWriter w(config, edi::SubmessageType::CA_FRAG_DATA_MESSAGE);
+    w.s << edi::CAFragDataMessage(seq_no, fragment_seq_no, id, uint32_t(values.size()), DBR_TIME_DOUBLE,
+                                  uint16_t(fragment_size));
+    w.s.write(dbr.data() + offset, fragment_size);
+    w.s.pad_align(edi::SubmessageHeader::alignment, 0);
+    return w.message();
+}
+
+std::vector<double> waveform(double base)
+{
+    std::vector<double> values(WAVEFORM_COUNT);
+    for (std::size_t i = 0; i < values.size(); i++) {
+        values[i] = base + double(i);
+    }
+    return values;
+}
+
+struct Update {
+    uint32_t channel_index;
+    uint32_t count;             // (uint32_t)-1 for disconnected
+    std::vector<uint8_t> value;
+};
+
+// Receiver running in its own thread for 'runtime' seconds, updates are collected.
+class ReceiverRun {
+public:
+    ReceiverRun(const edi::Config& config, double runtime) :
+        receiver(config, TEST_PORT, "127.0.0.1"),
+        sender(edi::parse_socket_address_list("127.0.0.1", TEST_PORT), 0),
+        thread([this, runtime]() {
+            receiver.run(runtime, [this](uint32_t channel_index, uint16_t type, uint32_t count, void* value) {
+                Update update{channel_index, count, std::vector<uint8_t>()};
+                if (count != (uint32_t)-1) {
+                    auto bytes = static_cast<const uint8_t*>(value);
+                    update.value.assign(bytes, bytes + dbr_size_n(type, count));
+                }
+                updates.push_back(std::move(update));
+            });
+        })
+    {
+    }
+
+    void send(const std::vector<uint8_t>& message) {
+        sender.send(message.data(), message.size());
+        // keep the order of arrival
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // updates are accessed only after the receiver thread has finished
+    std::vector<Update>& join() {
+        thread.join();
+        return updates;
+    }
+
+private:
+    edi::Receiver receiver;
+    edi::UDPSender sender;
+    std::vector<Update> updates;
+    std::thread thread;
+};
+
+void test_delta()
+{
+    testDiag("Partial (delta) array updates.");
+
+    auto config = test_config();
+    ReceiverRun run(config, 2.0);
+
+    std::vector<double> keyframe = {0, 1, 2, 3, 4, 5, 6, 7};
+    run.send(data_message(config, 1, ARRAY_CHANNEL, keyframe));
+    run.send(delta_message(config, 2, 1, ARRAY_CHANNEL, 8, {{element_offset(2), {20, 30}}, {element_offset(6), {60}}}));
+
+    // keyframe 3 lost, deltas are dropped until the next keyframe
+    run.send(delta_message(config, 4, 3, ARRAY_CHANNEL, 8, {{element_offset(0), {-1}}}));
+    run.send(delta_message(config, 5, 4, ARRAY_CHANNEL, 8, {{element_offset(1), {-1}}}));
+
+    std::vector<double> next_keyframe = {10, 11, 12, 13, 14, 15, 16, 17};
+    run.send(data_message(config, 6, ARRAY_CHANNEL, next_keyframe));
+    run.send(delta_message(config, 7, 6, ARRAY_CHANNEL, 8, {{element_offset(7), {170}}}));
+
+    // range out of the value bounds
+    run.send(delta_message(config, 8, 7, ARRAY_CHANNEL, 8, {{element_offset(8), {180}}}));
+
+    auto& updates = run.join();
+    testOk(updates.size() == 4, "Keyframes and applicable deltas delivered (%zu).", updates.size());
+    if (updates.size() == 4) {
+        testOk(from_dbr(updates[0].value) == keyframe, "Keyframe delivered.");
+        testOk(from_dbr(updates[1].value) == std::vector<double>({0, 1, 20, 30, 4, 5, 60, 7}),
+               "Delta ranges applied on the keyframe.");
+        testOk(from_dbr(updates[2].value) == next_keyframe, "Keyframe after a lost keyframe delivered.");
+        testOk(from_dbr(updates[3].value) == std::vector<double>({10, 11, 12, 13, 14, 15, 16, 170}),
+               "Delta applied on the keyframe after a lost keyframe.");
+    } else {
+        testSkip(4, "unexpected number of updates");
+    }
+}
+
+void test_reassembly()
+{
+    testDiag("Reassembly of fragmented values.");
+
+    auto config = test_config();
+    ReceiverRun run(config, 3.0);
+
+    // three fragments, received out of order and with a duplicate
+    auto first = waveform(0);
+    run.send(fragment_message(config, 1, 2, WAVEFORM_CHANNEL, first));
+    run.send(fragment_message(config, 1, 0, WAVEFORM_CHANNEL, first));
+    run.send(fragment_message(config, 1, 2, WAVEFORM_CHANNEL, first));
+    run.send(fragment_message(config, 1, 1, WAVEFORM_CHANNEL, first));
+
+    // completed after a newer update (disconnect) was delivered
+    auto stale = waveform(1000);
+    run.send(fragment_message(config, 2, 0, WAVEFORM_CHANNEL, stale));
+    run.send(fragment_message(config, 2, 1, WAVEFORM_CHANNEL, stale));
+    run.send(disconnect_message(config, 3, WAVEFORM_CHANNEL));
+    run.send(fragment_message(config, 2, 2, WAVEFORM_CHANNEL, stale));
+
+    // incomplete transfer expires, its fragments are not combined with the late one
+    auto expired = waveform(2000);
+    run.send(fragment_message(config, 4, 0, WAVEFORM_CHANNEL, expired));
+    run.send(fragment_message(config, 4, 1, WAVEFORM_CHANNEL, expired));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    run.send(fragment_message(config, 4, 2, WAVEFORM_CHANNEL, expired));
+
+    // a newer transfer supersedes the incomplete one
+    auto last = waveform(3000);
+    run.send(fragment_message(config, 5, 0, WAVEFORM_CHANNEL, last));
+    run.send(fragment_message(config, 5, 1, WAVEFORM_CHANNEL, last));
+    run.send(fragment_message(config, 5, 2, WAVEFORM_CHANNEL, last));
+
+    auto& updates = run.join();
+    testOk(updates.size() == 3, "Complete values and the disconnect delivered (%zu).", updates.size());
+    if (updates.size() == 3) {
+        testOk(updates[0].channel_index == WAVEFORM_CHANNEL && from_dbr(updates[0].value) == first,
+               "Value of out of order fragments reassembled.");
+        testOk(updates[1].channel_index == WAVEFORM_CHANNEL && updates[1].count == (uint32_t)-1,
+               "Disconnect delivered, older fragmented value dropped.");
+        testOk(updates[2].channel_index == WAVEFORM_CHANNEL && from_dbr(updates[2].value) == last,
+               "Value after an expired transfer reassembled.");
+    } else {
+        testSkip(3, "unexpected number of updates");
+    }
+}
+
+}
+
+
+MAIN(test_receiver)
+{
+    testPlan(9);
+
+    edi::Logger::set_default_log_level(edi::LogLevel::Error);
+    edi::SocketContext socket_context;
+
+    test_delta();
+    test_reassembly();
+
+    return testDone();
+}
@@ -0,0 +1,364 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "testMain.h"
+#include "epicsUnitTest.h"
+
+#include <envDefs.h>
+
+// internals of the sender (anonymous namespace, Sender::Impl) are tested directly
+#include "../../src/sender.cpp"
+
+namespace edi = epics_diode;
+
+namespace {
+
+// Messages assembled by the sender are received over the loopback interface.
+const int TEST_PORT = 15090;
+
+// Large arrays, two of them do not fit in a message, one does.
+const std::size_t LARGE_COUNT = 5000;
+
+// Array sent in two fragments, the tail is smaller than LARGE_COUNT array.
+const std::size_t FRAGMENTED_COUNT = 8300;
+
+// Array that fits in a data message, but not together with its latency telemetry.
+const std::size_t TELEMETRY_LIMIT_COUNT = 8179;
+
+edi::Config test_config(std::size_t channel_count)
+{
+    edi::Config config;
+    config.rate_limit_mbs = 0;
+    config.heartbeat_period = 1e6;      // no heartbeats
+    for (std::size_t i = 0; i < channel_count; i++) {
+        config.channels.emplace_back("test:ch" + std::to_string(i));
+    }
+    config.update_hash();
+    return config;
+}
+
+// Submessages of a message, e.g. "data(0,2) frag(1:0) timestamp" (channel ids, channel id:fragment_seq_no).
+std::string describe(uint8_t* message, std::size_t size)
+{
+    edi::Serializer s(message, size);
+    edi::Header header;
+    s >> header;
+
+    std::string result;
+    while (s.remaining() >= edi::SubmessageHeader::size) {
+        edi::SubmessageHeader subheader;
+        s >> subheader;
+        auto end = subheader.bytes_to_next_header ? s.position() + subheader.bytes_to_next_header : message + size;
+
+        if (!result.empty()) {
+            result += ' ';
+        }
+        if (subheader.id == edi::SubmessageType::CA_DATA_MESSAGE) {
+            edi::CADataMessage data;
+            s >> data;
+            result += "data(";
+            for (uint16_t i = 0; i < data.channel_count; i++) {
+                edi::CAChannelData channel_data;
+                s >> channel_data;
+                s += dbr_size_n(channel_data.type, channel_data.count);
+                s.pos_align(edi::SubmessageHeader::alignment, 0);
+                result += (i ? "," : "") + std::to_string(channel_data.id);
+            }
+            result += ")";
+        } else if (subheader.id == edi::SubmessageType::CA_FRAG_DATA_MESSAGE) {
+            edi::CAFragDataMessage fragment;
+            s >> fragment;
+            result += "frag(" + std::to_string(fragment.channel_id) + ":" +
+                      std::to_string(fragment.fragment_seq_no) + ")";
+        } else if (subheader.id == edi::SubmessageType::TIMESTAMP_MESSAGE) {
+            result += "timestamp";
+        } else {
+            result += "submessage(" + std::to_string(subheader.id) + ")";
+        }
+        s.position(end);
+    }
+    return result;
+}
+
+}
+
+namespace epics_diode {
+
+// Sender shard sending to the loopback interface.
+struct SenderTest {
+    explicit SenderTest(const Config& config) :
+        receiver(TEST_PORT, "127.0.0.1"),
+        transport(config, "127.0.0.1:" + std::to_string(TEST_PORT), 1),
+        impl(config, transport, 0, 0)
+    {
+        // fragments are not limited by the bandwidth share
+        impl.fragment_budget = std::numeric_limits<int64_t>::max();
+    }
+
+    // Event of a connected DBR_DOUBLE channel with 'count' elements (the first one set to 'value').
+    void update(uint32_t index, std::size_t count, dbr_short_t severity = 0, double value = 0.0) {
+        Channel& ch = impl.channels[index];
+        ch.channel_type = DBR_DOUBLE;
+        ch.element_count = count;
+        set_dbr_type(&ch);
+        ch.status = ECA_NORMAL;
+
+        std::vector<uint8_t> dbr(dbr_size_n(DBR_TIME_DOUBLE, count));
+        auto* time_dbr = reinterpret_cast<dbr_time_double*>(dbr.data());
+        time_dbr->severity = severity;
+        time_dbr->value = value;
+        process_event(&ch, ECA_NORMAL, DBR_TIME_DOUBLE, long(count), dbr.data());
+    }
+
+    // Sends the pending updates, returns the received messages (see describe()).
+    std::vector<std::string> send() {
+        impl.send_updates();
+
+        std::vector<std::string> messages;
+        std::vector<uint8_t> buffer(MAX_MESSAGE_SIZE);
+        osiSockAddr from;
+        ssize_t bytes;
+        while ((bytes = receiver.receive(buffer.data(), buffer.size(), &from)) > 0) {
+            messages.push_back(describe(buffer.data(), std::size_t(bytes)));
+        }
+        return messages;
+    }
+
+    // Heartbeat period (the carousel covers all the channels), refreshes channels without updates.
+    std::vector<std::string> heartbeat() {
+        impl.advance_heartbeat_carousel();
+        return send();
+    }
+
+    // Next update period, sends the pending updates (including the deferred ones that are due).
+    std::vector<std::string> next_period() {
+        impl.release_deferred_updates();
+        return send();
+    }
+
+    UDPReceiver receiver;
+    Sender::Transport transport;
+    Sender::Impl impl;
+};
+
+}
+
+namespace {
+
+void test_reorder_fill()
+{
+    testDiag("Message filled with smaller updates queued behind the one that does not fit.");
+
+    auto config = test_config(3);
+    config.reorder_window = 4;
+    edi::SenderTest test(config);
+
+    test.update(0, LARGE_COUNT);
+    test.update(1, LARGE_COUNT);
+    test.update(2, 1);
+
+    auto messages = test.send();
+    testOk(messages.size() == 2, "Two messages sent (%zu).", messages.size());
+    if (messages.size() == 2) {
+        testOk(messages[0] == "data(0,2)", "Smaller update sent out of order in the first message (%s).",
+               messages[0].c_str());
+        testOk(messages[1] == "data(1)", "Update that did not fit sent in the next message (%s).",
+               messages[1].c_str());
+    } else {
+        testSkip(2, "unexpected number of messages");
+    }
+}
+
+void test_fragment_tail()
+{
+    testDiag("Fragment tail appended to a message with free space.");
+
+    auto config = test_config(3);
+    config.reorder_window = 0;
+    edi::SenderTest test(config);
+
+    test.update(0, FRAGMENTED_COUNT);
+    test.update(1, LARGE_COUNT);
+    test.update(2, LARGE_COUNT);
+
+    auto messages = test.send();
+    testOk(messages.size() == 3, "Three messages sent (%zu).", messages.size());
+    if (messages.size() == 3) {
+        testOk(messages[0] == "frag(0:0)", "First fragment sent in its own message (%s).",
+               messages[0].c_str());
+        testOk(messages[1] == "data(1) frag(0:1)",
+               "Tail appended to the message in which the next update did not fit (%s).",
+               messages[1].c_str());
+        testOk(messages[2] == "data(2)", "Next update sent in its own message (%s).",
+               messages[2].c_str());
+    } else {
+        testSkip(3, "unexpected number of messages");
+    }
+}
+
+void test_telemetry_fragmentation()
+{
+    testDiag("Value that does not fit with its latency telemetry sent in fragments.");
+
+    auto config = test_config(2);
+    config.latency_telemetry = true;
+    config.reorder_window = 0;
+    edi::SenderTest test(config);
+
+    test.update(0, TELEMETRY_LIMIT_COUNT);
+    test.update(1, 1);
+
+    auto messages = test.send();
+    testOk(messages.size() == 2, "Two messages sent (%zu).", messages.size());
+    if (messages.size() == 2) {
+        testOk(messages[0] == "frag(0:0)", "Value sent as a fragment (%s).", messages[0].c_str());
+        testOk(messages[1] == "data(1) timestamp", "Next update sent with its telemetry (%s).",
+               messages[1].c_str());
+    } else {
+        testSkip(2, "unexpected number of messages");
+    }
+}
+
+void test_deferred_update()
+{
+    testDiag("Deferred (rate-limited) update after a promoted update.");
+
+    auto config = test_config(1);
+    config.channels[0].min_update_period = 10 * config.min_update_period;
+    edi::SenderTest test(config);
+
+    // deferred until period 10, then sent as a promoted (alarm) update in period 2
+    test.update(0, 1);
+    test.next_period();
+    test.next_period();
+    test.update(0, 1, 1);
+    auto promoted = test.send();
+
+    // deferred until period 12, the entry of period 10 is stale
+    test.update(0, 1, 1);
+    std::size_t early = 0;
+    for (int period = 3; period < 12; period++) {
+        early += test.next_period().size();
+    }
+    auto due = test.next_period();
+
+    testOk(promoted.size() == 1, "Promoted update sent immediately (%zu).", promoted.size());
+    testOk(early == 0, "Deferred update not released by a stale entry (%zu message(s) early).", early);
+    testOk(due.size() == 1, "Deferred update sent when due (%zu).", due.size());
+}
+
+void test_deadband_heartbeat()
+{
+    testDiag("Deadband reference after a value within the deadband was sent with a heartbeat.");
+
+    auto config = test_config(1);
+    config.heartbeat_period = 0.1;
+    config.channels[0].deadband_abs = 1.0;
+    edi::SenderTest test(config);
+
+    test.update(0, 1, 0, 0.0);
+    auto first = test.send();
+    test.update(0, 1, 0, 0.6);
+    auto suppressed = test.send();
+
+    // the first heartbeat period had an update
+    test.heartbeat();
+    auto heartbeat = test.heartbeat();
+
+    // within the deadband of the first value, but not of the one sent with the heartbeat
+    test.update(0, 1, 0, -0.9);
+    auto drift = test.send();
+
+    testOk(first.size() == 1 && suppressed.empty(), "Value within the deadband suppressed.");
+    testOk(heartbeat.size() == 1, "Suppressed value sent with the heartbeat (%zu).", heartbeat.size());
+    testOk(drift.size() == 1, "Value beyond the deadband of the value sent with the heartbeat sent (%zu).",
+           drift.size());
+}
+
+void test_event_recycling()
+{
+    testDiag("Events of preemptive callbacks handed over by several threads and recycled.");
+
+    const std::size_t PRODUCERS = 4;
+    const long EVENTS = 20000;
+    edi::EventQueue queue;
+
+    std::vector<std::thread> producers;
+    for (std::size_t p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&queue, p, EVENTS]() {
+            for (long n = 0; n < EVENTS; n++) {
+                auto* event = queue.acquire();
+                event->kind = edi::EventQueue::Kind::event;
+                event->type = long(p);
+                event->count = n;
+                event->dbr.assign(8, uint8_t(n));
+                queue.push(event);
+            }
+        });
+    }
+
+    // events of each producer are received in order
+    std::vector<long> next(PRODUCERS, 0);
+    std::set<const edi::EventQueue::Event*> distinct;
+    std::size_t received = 0;
+    bool ordered = true;
+    while (received < PRODUCERS * EVENTS) {
+        auto* event = queue.pop();
+        if (!event) {
+            std::this_thread::yield();
+            continue;
+        }
+        ordered &= (event->count == next[event->type]++ && event->dbr.size() == 8 &&
+                    event->dbr[0] == uint8_t(event->count));
+        distinct.insert(event);
+        received++;
+        queue.recycle(event);
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    // steady state, events come from the free ring
+    std::size_t allocated = 0;
+    for (long n = 0; n < EVENTS; n++) {
+        auto* event = queue.acquire();
+        allocated += distinct.count(event) ? 0 : 1;
+        queue.push(event);
+        queue.recycle(queue.pop());
+    }
+
+    testOk(ordered, "All the events received in order.");
+    testOk(allocated == 0, "Recycled events reused (%zu allocated).", allocated);
+}
+
+}
+
+
+MAIN(test_sender)
+{
+    testPlan(18);
+
+    // no CA server, channels are never searched for
+    epicsEnvSet("EPICS_CA_AUTO_ADDR_LIST", "NO");
+    epicsEnvSet("EPICS_CA_ADDR_LIST", "");
+    edi::Logger::set_default_log_level(edi::LogLevel::Error);
+    edi::SocketContext socket_context;
+
+    test_reorder_fill();
+    test_fragment_tail();
+    test_telemetry_fragmentation();
+    test_deferred_update();
+    test_deadband_heartbeat();
+    test_event_recycling();
+
+    return testDone();
+}